@@ -0,0 +1,315 @@
+// bench.cpp
+//
+// lms_bench: times the catalog's hot paths on synthetic catalogs of each
+// size asked for, so that runs on two commits can be compared.
+//
+//   lms_bench [--sizes 1000,100000,1000000,10000000] [--seed N]
+//
+// Results go to stdout as JSON, one entry per operation and size with its
+// ns/op and allocations/op (every operator new is counted); a table of the
+// same goes to stderr. Work happens in a fresh directory under $TMPDIR,
+// removed at the end.
+//
+// The catalogs are generated, not sampled: authors are drawn Zipf-
+// distributed (exponent 0.7) from a pool of one per four books, so a few
+// are prolific and most have a book or two; titles are 1 to 12 words,
+// Zipf-distributed with shorter ones likelier, over a 50,000-word
+// vocabulary drawn from the same way (exponent 0.6); ISBN-13s are valid
+// and spread over the whole number space. The same seed and size give the
+// same catalog on every machine.
+
+#include "book.hpp"
+#include "library.hpp"
+#include "lms_project.hpp"
+
+namespace {
+
+std::atomic<ul> allocations{0};
+
+} // namespace
+
+void *operator new(std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  void *p(std::malloc(size ? size : 1));
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+const ul sampleLimit(100000); // most lookups timed per operation
+const ul fuzzyLimit(200);     // fuzzy lookups scan many authors each
+const ul pageSize(20);
+
+// ranks 0 .. n - 1, rank r drawn with probability proportional to 1/(r+1)^s
+class Zipf {
+public:
+  Zipf(ul n, double s) : cdf(std::max<ul>(n, 1)) {
+    double sum(0);
+    for (ul r = 0; r < cdf.size(); r++) {
+      sum += 1 / std::pow(r + 1, s);
+      cdf[r] = sum;
+    }
+    for (double &c : cdf) {
+      c /= sum;
+    }
+  }
+  ul operator()(std::mt19937_64 &rng) const {
+    double u(std::uniform_real_distribution<double>(0, 1)(rng));
+    ul r(std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin());
+    return std::min<ul>(r, cdf.size() - 1);
+  }
+
+private:
+  std::vector<double> cdf;
+};
+
+// a pronounceable word for every number, different numbers different words
+std::string syllables(ul n, bool capital) {
+  static const char *parts[] = {"ka", "ro", "mi", "sen", "tal", "ve", "dor",
+                                "lu", "bri", "an", "est", "or", "qui", "na",
+                                "hel", "zu"};
+  std::string word;
+  do {
+    word += parts[n % 16];
+    n /= 16;
+  } while (n > 0);
+  if (capital) {
+    word[0] = char(std::toupper(word[0]));
+  }
+  return word;
+}
+
+// the i-th of a billion ISBN-13s, scattered so neighbours are far apart
+std::string syntheticISBN(ul i) {
+  ul body((i * 387420489UL) % 1000000000UL); // 3^18 is prime to 10^9
+  char digits[14];
+  snprintf(digits, sizeof(digits), "978%09lu", body);
+  int sum(0);
+  for (int d = 0; d < 12; d++) {
+    sum += (digits[d] - '0') * (d % 2 ? 3 : 1);
+  }
+  digits[12] = char('0' + (10 - sum % 10) % 10);
+  digits[13] = '\0';
+  return digits;
+}
+
+class CatalogGenerator {
+public:
+  CatalogGenerator(ul books, uint64_t seed)
+      : rng(seed), authors(std::max<ul>(books / 4, 1), 0.7),
+        words(50000, 0.6), titleLength(12, 1.0) {}
+
+  void next(std::string &title, std::string &author, std::string &isbn) {
+    title.clear();
+    ul length(1 + titleLength(rng));
+    for (ul w = 0; w < length; w++) {
+      if (w > 0) {
+        title += ' ';
+      }
+      title += syllables(words(rng), w == 0);
+    }
+    ul a(authors(rng));
+    author = syllables(a, true) + ", " + syllables(a / 7 + 3, true);
+    isbn = syntheticISBN(count++);
+  }
+
+private:
+  std::mt19937_64 rng;
+  Zipf authors;
+  Zipf words;
+  Zipf titleLength;
+  ul count = 0;
+};
+
+struct Result {
+  std::string name;
+  ul books;
+  ul ops;
+  double ns;
+  ul allocs;
+};
+
+std::vector<Result> results;
+
+// one run of body, doing ops operations, added to the named result
+void measure(const std::string &name, ul books, ul ops,
+             const std::function<void()> &body) {
+  ul allocsBefore(allocations.load());
+  auto started(std::chrono::steady_clock::now());
+  body();
+  double ns(std::chrono::duration<double, std::nano>(
+                std::chrono::steady_clock::now() - started)
+                .count());
+  ul allocs(allocations.load() - allocsBefore);
+  for (Result &r : results) {
+    if (r.name == name && r.books == books) {
+      r.ops += ops;
+      r.ns += ns;
+      r.allocs += allocs;
+      return;
+    }
+  }
+  results.push_back({name, books, ops, ns, allocs});
+}
+
+void benchSize(ul n, uint64_t seed) {
+  std::mt19937_64 rng(seed ^ n);
+  std::vector<std::array<std::string, 3>> sample;
+  ul m(std::min(n, sampleLimit));
+  {
+    Library aLibrary;
+    CatalogGenerator generate(n, seed);
+    std::vector<std::array<std::string, 3>> batch(std::min<ul>(n, 65536));
+    for (ul done = 0; done < n;) {
+      ul count(std::min<ul>(batch.size(), n - done));
+      for (ul i = 0; i < count; i++) { // generating is not timed
+        generate.next(batch[i][0], batch[i][1], batch[i][2]);
+      }
+      measure("add_book", n, count, [&]() {
+        for (ul i = 0; i < count; i++) {
+          aLibrary.addBook(batch[i][0], batch[i][1], batch[i][2]);
+        }
+      });
+      done += count;
+    }
+
+    vpBook found;
+    std::vector<ul> picks(n); // distinct books, so every remove finds one
+    std::iota(picks.begin(), picks.end(), 0);
+    std::shuffle(picks.begin(), picks.end(), rng);
+    for (ul i = 0; i < m; i++) {
+      aLibrary.catalogPage(orderISBN, picks[i], 1, found);
+      sample.push_back({found[0]->getTitle(), found[0]->getAuthor(),
+                        found[0]->getISBN()});
+    }
+    measure("search_by_isbn", n, m, [&]() {
+      for (const auto &s : sample) {
+        aLibrary.searchByISBN(s[2], found);
+      }
+    });
+    measure("search_by_title", n, m, [&]() {
+      for (const auto &s : sample) {
+        aLibrary.searchByTitle(s[0], found);
+      }
+    });
+    measure("search_by_author", n, m, [&]() {
+      for (const auto &s : sample) {
+        aLibrary.searchByAuthor(s[1], found);
+      }
+    });
+    std::vector<std::string> typos; // one letter dropped from the name
+    for (ul i = 0; i < std::min(m, fuzzyLimit); i++) {
+      typos.push_back(sample[i][1]);
+      typos.back().erase(typos.back().size() / 2, 1);
+    }
+    vSV near;
+    measure("fuzzy_authors", n, typos.size(), [&]() {
+      for (const std::string &typo : typos) {
+        aLibrary.fuzzyAuthors(typo, typosAllowed(typo), 4, near);
+      }
+    });
+    std::vector<ul> firsts(m);
+    for (ul &f : firsts) {
+      f = rng() % n;
+    }
+    measure("paginate", n, m, [&]() {
+      for (ul i = 0; i < m; i++) {
+        aLibrary.catalogPage(CatalogOrder(i % orderCount), firsts[i],
+                             pageSize, found);
+      }
+    });
+
+    vpBook books;
+    aLibrary.catalog(books);
+    std::shuffle(books.begin(), books.end(), rng);
+    vpBook shuffled(books);
+    measure("sort_catalog_title", n, 1, [&]() { sortCatalogTitle(books); });
+    books = shuffled;
+    measure("sort_catalog_author", n, 1, [&]() { sortCatalogAuthor(books); });
+    books = shuffled;
+    measure("sort_catalog_isbn", n, 1, [&]() { sortCatalogISBN(books); });
+
+    measure("serialize", n, 1, [&]() { aLibrary.serialize(); });
+  }
+
+  Library aLibrary;
+  measure("deserialize", n, 1, [&]() { aLibrary.deserialize(); });
+  aLibrary.setJournalSyncEvery(0); // time the edit, not the disk
+  measure("remove_book", n, m, [&]() {
+    for (const auto &s : sample) {
+      aLibrary.removeBook(s[2]);
+    }
+  });
+  unlink("library_data.lms");
+  unlink("library_data.journal");
+}
+
+// the JSON string literal for s (names here need no escaping beyond this)
+std::string quoted(const std::string &s) { return "\"" + s + "\""; }
+
+void report() {
+  printf("{\n  \"results\": [\n");
+  for (ul i = 0; i < results.size(); i++) {
+    const Result &r(results[i]);
+    printf("    {\"name\": %s, \"books\": %lu, \"ops\": %lu, "
+           "\"ns_per_op\": %.1f, \"allocs_per_op\": %.2f}%s\n",
+           quoted(r.name).c_str(), r.books, r.ops, r.ns / r.ops,
+           double(r.allocs) / r.ops, i + 1 < results.size() ? "," : "");
+    fprintf(stderr, "%-20s %10lu books %12.1f ns/op %10.2f allocs/op\n",
+            r.name.c_str(), r.books, r.ns / r.ops, double(r.allocs) / r.ops);
+  }
+  printf("  ]\n}\n");
+}
+
+// false on a malformed list
+bool parseSizes(const std::string &list, std::vector<ul> &sizes) {
+  sizes.clear();
+  std::stringstream in(list);
+  std::string item;
+  while (std::getline(in, item, ',')) {
+    char *end;
+    ul n(std::strtoul(item.c_str(), &end, 10));
+    if (item.empty() || *end != '\0' || n == 0) {
+      return false;
+    }
+    sizes.push_back(n);
+  }
+  return !sizes.empty();
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::vector<ul> sizes{1000, 100000, 1000000, 10000000};
+  uint64_t seed(42);
+  for (int i = 1; i < argc; i++) {
+    std::string arg(argv[i]);
+    if (arg == "--sizes" && i + 1 < argc && parseSizes(argv[i + 1], sizes)) {
+      i++;
+    } else if (arg == "--seed" && i + 1 < argc) {
+      seed = std::strtoull(argv[++i], nullptr, 10);
+    } else {
+      fprintf(stderr, "usage: lms_bench [--sizes N,N,...] [--seed N]\n");
+      return 2;
+    }
+  }
+  const char *tmp(std::getenv("TMPDIR"));
+  std::string dir(std::string(tmp && *tmp ? tmp : "/tmp") +
+                  "/lms_bench.XXXXXX");
+  if (!mkdtemp(dir.data()) || chdir(dir.c_str()) != 0) {
+    fprintf(stderr, "lms_bench: cannot make a directory to work in\n");
+    return 1;
+  }
+  for (ul n : sizes) {
+    benchSize(n, seed);
+  }
+  rmdir(dir.c_str());
+  report();
+  return 0;
+}
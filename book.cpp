@@ -2,36 +2,174 @@
 
 #include "book.hpp"
 #include "lms_project.hpp"
+#include "text.hpp"
 
-Book::Book(const std::string &title, const std::string &author,
-           const std::string &isbn)
-    : title(title), author(author), isbn(isbn) {}
+namespace {
+
+// the pooled folded form of s; s itself when folding leaves it unchanged
+std::string_view foldedKey(std::string_view s, StringPool &pool) {
+  std::string folded(foldText(s));
+  return folded == s ? s : pool.intern(folded);
+}
+
+} // namespace
+
+Book::Book(std::string_view title, std::string_view author,
+           std::string_view isbn) {
+  own(title, author, isbn, foldText(title), foldText(author));
+}
+
+Book::Book(std::string_view title, std::string_view author,
+           std::string_view isbn, StringPool &pool)
+    : title(pool.intern(title)), author(pool.intern(author)),
+      isbn(pool.intern(isbn)), titleKey(foldedKey(this->title, pool)),
+      authorKey(foldedKey(this->author, pool)) {}
 
 Book::Book() { Book::clear(); }
 
+Book::Book(const Book &other) { *this = other; }
+
+// an owned buffer is copied, and the views moved over to the copy
+Book &Book::operator=(const Book &other) {
+  if (this == &other) {
+    return *this;
+  }
+  title = other.title;
+  author = other.author;
+  isbn = other.isbn;
+  titleKey = other.titleKey;
+  authorKey = other.authorKey;
+  owned.reset();
+  if (other.owned) {
+    owned = std::make_unique<std::string>(*other.owned);
+    const char *from(other.owned->data());
+    for (std::string_view *v : {&title, &author, &isbn, &titleKey,
+                                &authorKey}) {
+      *v = std::string_view(owned->data() + (v->data() - from), v->size());
+    }
+  }
+  return *this;
+}
+
 Book::~Book() { Book::clear(); }
 
+// for views that already live in pool (or storage it retains)
+Book Book::fromPool(std::string_view title, std::string_view author,
+                    std::string_view isbn, StringPool &pool) {
+  Book aBook;
+  aBook.title = title;
+  aBook.author = author;
+  aBook.isbn = isbn;
+  aBook.titleKey = foldedKey(title, pool);
+  aBook.authorKey = foldedKey(author, pool);
+  return aBook;
+}
+
+// a copy whose text, keys included, lives in pool; nothing is folded again
+Book Book::pooledIn(StringPool &pool) const {
+  Book aBook;
+  aBook.title = pool.intern(title);
+  aBook.author = pool.intern(author);
+  aBook.isbn = pool.intern(isbn);
+  aBook.titleKey = pool.intern(titleKey);
+  aBook.authorKey = pool.intern(authorKey);
+  return aBook;
+}
+
+/*
+ for a short-lived Book over views that are not pooled, keys included: nothing
+ is interned, so worker threads may build these. The caller keeps the views
+ alive for as long as the Book is used.
+ */
+Book Book::fromViews(std::string_view title, std::string_view author,
+                     std::string_view isbn, std::string_view titleKey,
+                     std::string_view authorKey) {
+  Book aBook;
+  aBook.title = title;
+  aBook.author = author;
+  aBook.isbn = isbn;
+  aBook.titleKey = titleKey;
+  aBook.authorKey = authorKey;
+  return aBook;
+}
+
 void Book::clear() {
-  title.clear();
-  author.clear();
-  isbn.clear();
+  title = std::string_view();
+  author = std::string_view();
+  isbn = std::string_view();
+  titleKey = std::string_view();
+  authorKey = std::string_view();
+  owned.reset();
 }
 
-std::string Book::getTitle() const { return title; }
+/*
+ puts the fields in a fresh buffer of the Book's own and views them there.
+ They may view the old buffer, which is only dropped once they are copied.
+ */
+void Book::own(std::string_view newTitle, std::string_view newAuthor,
+               std::string_view newISBN, std::string_view newTitleKey,
+               std::string_view newAuthorKey) {
+  std::string_view fields[5] = {newTitle, newAuthor, newISBN, newTitleKey,
+                                newAuthorKey};
+  ul at[5];
+  auto text(std::make_unique<std::string>());
+  text->reserve(newTitle.size() + newAuthor.size() + newISBN.size() +
+                newTitleKey.size() + newAuthorKey.size());
+  for (int f = 0; f < 5; f++) {
+    at[f] = text->size();
+    text->append(fields[f]);
+  }
+  title = std::string_view(text->data() + at[0], newTitle.size());
+  author = std::string_view(text->data() + at[1], newAuthor.size());
+  isbn = std::string_view(text->data() + at[2], newISBN.size());
+  titleKey = std::string_view(text->data() + at[3], newTitleKey.size());
+  authorKey = std::string_view(text->data() + at[4], newAuthorKey.size());
+  owned = std::move(text);
+}
 
-std::string Book::getAuthor() const { return author; }
+std::string Book::getTitle() const { return std::string(title); }
 
-std::string Book::getISBN() const { return isbn; }
+std::string Book::getAuthor() const { return std::string(author); }
 
-void Book::setTitle(const std::string &newTitle) { title = newTitle; }
+std::string Book::getISBN() const { return std::string(isbn); }
 
-void Book::setAuthor(const std::string &newAuthor) { author = newAuthor; }
+// the set* functions leave the Book owning its text, whatever it viewed
+void Book::setTitle(std::string_view newTitle) {
+  own(newTitle, author, isbn, foldText(newTitle), authorKey);
+}
 
-void Book::setISBN(const std::string &newISBN) { isbn = newISBN; }
+void Book::setAuthor(std::string_view newAuthor) {
+  own(title, newAuthor, isbn, titleKey, foldText(newAuthor));
+}
+
+void Book::setISBN(std::string_view newISBN) {
+  own(title, author, newISBN, titleKey, authorKey);
+}
 
-std::string Book::formatBook(int l, int c, int r) {
+std::string Book::formatBook(int l, int c, int r) const {
   std::stringstream sst;
   sst << std::right << std::setw(l) << Book::title << std::right << std::setw(c)
       << Book::author << std::right << std::setw(r) << Book::isbn << std::endl;
   return sst.str();
 }
+
+void sortCatalogAuthor(vpBook &books) {
+  std::sort(books.begin(), books.end(),
+            [](const Book *book1, const Book *book2) {
+              return book1->getAuthorKey() < book2->getAuthorKey();
+            });
+}
+
+void sortCatalogTitle(vpBook &books) {
+  std::sort(books.begin(), books.end(),
+            [](const Book *book1, const Book *book2) {
+              return book1->getTitleKey() < book2->getTitleKey();
+            });
+}
+
+void sortCatalogISBN(vpBook &books) {
+  std::sort(books.begin(), books.end(),
+            [](const Book *book1, const Book *book2) {
+              return book1->getISBNView() < book2->getISBNView();
+            });
+}
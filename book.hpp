@@ -3,21 +3,52 @@
 #define BOOK_HPP
 
 #include "lms_project.hpp"
+#include "string_pool.hpp"
+#include "text.hpp"
 
+/*
+ A Book in a catalog views its text in the owning Library's StringPool (see
+ string_pool.hpp), so copying it copies views, and a repeated author is
+ stored once however many books name it. Any other Book, such as the one
+ the TUI fills in as the user types or one read from a legacy archive,
+ owns one buffer holding its text, which goes with it; copying that Book
+ copies the buffer. The get*View accessors hand out views without
+ copying; get* return an owned std::string as before.
+
+ The folded title and author (see text.hpp) are worked out once, whenever
+ the field is set, and kept as getTitleKey/getAuthorKey for searching and
+ sorting, so comparisons never fold.
+ */
 class Book {
 public:
-  Book(const std::string &title, const std::string &author,
-       const std::string &isbn);
+  Book(std::string_view title, std::string_view author, std::string_view isbn);
+  Book(std::string_view title, std::string_view author, std::string_view isbn,
+       StringPool &pool);
   Book();
+  Book(const Book &other);
+  Book(Book &&) = default;
+  Book &operator=(const Book &other);
+  Book &operator=(Book &&) = default;
   ~Book();
-  std::string formatBook(int = 22, int = 22, int = 22);
+  static Book fromPool(std::string_view title, std::string_view author,
+                       std::string_view isbn, StringPool &pool);
+  static Book fromViews(std::string_view title, std::string_view author,
+                        std::string_view isbn, std::string_view titleKey,
+                        std::string_view authorKey);
+  Book pooledIn(StringPool &pool) const;
+  std::string formatBook(int = 22, int = 22, int = 22) const;
   std::string getAuthor() const;
   std::string getISBN() const;
   std::string getTitle() const;
+  std::string_view getAuthorView() const { return author; }
+  std::string_view getISBNView() const { return isbn; }
+  std::string_view getTitleView() const { return title; }
+  std::string_view getAuthorKey() const { return authorKey; }
+  std::string_view getTitleKey() const { return titleKey; }
   void clear();
-  void setAuthor(const std::string &author);
-  void setISBN(const std::string &isbn);
-  void setTitle(const std::string &title);
+  void setAuthor(std::string_view author);
+  void setISBN(std::string_view isbn);
+  void setTitle(std::string_view title);
 
   bool operator<(const Book &other) const {
     if (author == other.author) {
@@ -32,27 +63,53 @@ public:
   friend class boost::serialization::access;
 
   template <class Archive>
-  void serialize(Archive &ar, const unsigned int version) {
-    ar &title;
-    ar &author;
-    ar &isbn;
+  void save(Archive &ar, const unsigned int) const {
+    std::string t(title), a(author), i(isbn);
+    ar &t;
+    ar &a;
+    ar &i;
+  }
+
+  template <class Archive> void load(Archive &ar, const unsigned int) {
+    std::string t, a, i;
+    ar &t;
+    ar &a;
+    ar &i;
+    setTitle(t);
+    setAuthor(a);
+    setISBN(i);
   }
 
+  BOOST_SERIALIZATION_SPLIT_MEMBER()
+
 private:
-  std::string title;
-  std::string author;
-  std::string isbn;
+  void own(std::string_view title, std::string_view author,
+           std::string_view isbn, std::string_view titleKey,
+           std::string_view authorKey);
+
+  std::string_view title;
+  std::string_view author;
+  std::string_view isbn;
+  std::string_view titleKey;  // foldText(title)
+  std::string_view authorKey; // foldText(author)
+  // the text, when no pool holds it; a std::string on the heap does not
+  // move with the Book, so a moved Book's views stay valid
+  std::unique_ptr<std::string> owned;
 };
 
 namespace std {
 template <> struct hash<Book> {
   size_t operator()(const Book &book) const {
-    return ((hash<string>()(book.getTitle()) ^
-             (hash<string>()(book.getAuthor()) << 1) ^
-             (hash<string>()(book.getISBN()) << 2)) >>
-            2);
+    size_t h(hash<string_view>()(book.getTitleView()));
+    h = hashCombine(h, hash<string_view>()(book.getAuthorView()));
+    return hashCombine(h, hash<string_view>()(book.getISBNView()));
   }
 };
 } // namespace std
 
+// the TUI's catalog orders: folded author, folded title, ISBN as entered
+void sortCatalogAuthor(vpBook &books);
+void sortCatalogISBN(vpBook &books);
+void sortCatalogTitle(vpBook &books);
+
 #endif // BOOK_HPP
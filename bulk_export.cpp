@@ -0,0 +1,220 @@
+// bulk_export.cpp
+
+#include "bulk_export.hpp"
+#include "lms_project.hpp"
+#include "text.hpp"
+
+namespace {
+
+// line breaks become spaces: bulk_import reads no quoted field across lines
+void putCSV(FileWriter &out, std::string_view field) {
+  bool quoted(field.find_first_of(",\"") != std::string_view::npos);
+  if (quoted) {
+    out.put('"');
+  }
+  for (ul i = field.find_first_of("\"\r\n"); i != std::string_view::npos;
+       i = field.find_first_of("\"\r\n")) {
+    out.put(field.substr(0, i));
+    out.put(field[i] == '"' ? std::string_view("\"\"") : " ");
+    field.remove_prefix(i + 1);
+  }
+  out.put(field);
+  if (quoted) {
+    out.put('"');
+  }
+}
+
+void putJSON(FileWriter &out, std::string_view field) {
+  static const char hex[] = "0123456789abcdef";
+  out.put('"');
+  ul from(0);
+  for (ul i = 0; i < field.size(); i++) {
+    unsigned char ch(field[i]);
+    if (ch >= 0x20 && ch != '"' && ch != '\\') {
+      continue;
+    }
+    out.put(field.substr(from, i - from));
+    from = i + 1;
+    if (ch == '"' || ch == '\\') {
+      out.put('\\');
+      out.put(char(ch));
+    } else {
+      char escaped[] = {'\\', 'u', '0', '0', hex[ch >> 4], hex[ch & 15]};
+      out.put(std::string_view(escaped, sizeof(escaped)));
+    }
+  }
+  out.put(field.substr(from));
+  out.put('"');
+}
+
+void putTSV(FileWriter &out, std::string_view field) {
+  for (ul i = field.find_first_of("\t\r\n"); i != std::string_view::npos;
+       i = field.find_first_of("\t\r\n")) {
+    out.put(field.substr(0, i));
+    out.put(' ');
+    field.remove_prefix(i + 1);
+  }
+  out.put(field);
+}
+
+} // namespace
+
+bool exportFormatFor(const std::string &path, ExportFormat &format) {
+  ul dot(path.rfind('.'));
+  if (dot == std::string::npos) {
+    return false;
+  }
+  std::string ext(foldText(path.substr(dot + 1)));
+  if (ext == "csv") {
+    format = exportCSV;
+  } else if (ext == "jsonl" || ext == "ndjson" || ext == "json") {
+    format = exportJSONLines;
+  } else if (ext == "tsv") {
+    format = exportTSV;
+  } else if (ext == "txt") {
+    format = exportArchive;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+FileWriter::~FileWriter() { close(); }
+
+bool FileWriter::open(const std::string &path) {
+  close();
+  if (!attach(::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644))) {
+    return false;
+  }
+  owned = true;
+  return true;
+}
+
+bool FileWriter::attach(int descriptor) {
+  close();
+  fd = descriptor;
+  owned = false;
+  if (fd < 0) {
+    return false;
+  }
+  if (!buffer) {
+    buffer.reset(new char[bufferSize]);
+  }
+  setp(buffer.get(), buffer.get() + bufferSize);
+  failed = false;
+  return true;
+}
+
+bool FileWriter::close() {
+  if (fd < 0) {
+    return false;
+  }
+  drain();
+  if (owned && ::close(fd) != 0) {
+    failed = true;
+  }
+  fd = -1;
+  setp(nullptr, nullptr);
+  return !failed;
+}
+
+void FileWriter::put(std::string_view s) {
+  if (fd < 0) {
+    return;
+  }
+  if (ul(epptr() - pptr()) >= s.size()) {
+    std::memcpy(pptr(), s.data(), s.size());
+    pbump(int(s.size()));
+    return;
+  }
+  xsputn(s.data(), s.size());
+}
+
+void FileWriter::put(char ch) {
+  if (fd < 0) {
+    return;
+  }
+  if (pptr() == epptr()) {
+    drain();
+  }
+  *pptr() = ch;
+  pbump(1);
+}
+
+// writes out what the buffer holds and empties it
+bool FileWriter::drain() {
+  const char *p(pbase());
+  while (p < pptr() && !failed) {
+    ssize_t n(::write(fd, p, pptr() - p));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      failed = true;
+      break;
+    }
+    p += n;
+  }
+  setp(buffer.get(), buffer.get() + bufferSize);
+  return !failed;
+}
+
+FileWriter::int_type FileWriter::overflow(int_type ch) {
+  if (fd < 0 || !drain()) {
+    return traits_type::eof();
+  }
+  if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+  }
+  return traits_type::not_eof(ch);
+}
+
+std::streamsize FileWriter::xsputn(const char *s, std::streamsize n) {
+  std::streamsize left(n);
+  while (left > 0 && fd >= 0) {
+    if (pptr() == epptr() && !drain()) {
+      break;
+    }
+    std::streamsize room(std::min<std::streamsize>(epptr() - pptr(), left));
+    std::memcpy(pptr(), s, room);
+    pbump(int(room));
+    s += room;
+    left -= room;
+  }
+  return n - left;
+}
+
+int FileWriter::sync() { return fd >= 0 && drain() ? 0 : -1; }
+
+void writeHeader(FileWriter &out, ExportFormat format) {
+  if (format == exportCSV) {
+    out.put("title,author,isbn\n");
+  }
+}
+
+void writeRecord(FileWriter &out, ExportFormat format, std::string_view title,
+                 std::string_view author, std::string_view isbn) {
+  if (format == exportCSV) {
+    putCSV(out, title);
+    out.put(',');
+    putCSV(out, author);
+    out.put(',');
+    putCSV(out, isbn);
+  } else if (format == exportTSV) {
+    putTSV(out, title);
+    out.put('\t');
+    putTSV(out, author);
+    out.put('\t');
+    putTSV(out, isbn);
+  } else {
+    out.put("{\"title\":");
+    putJSON(out, title);
+    out.put(",\"author\":");
+    putJSON(out, author);
+    out.put(",\"isbn\":");
+    putJSON(out, isbn);
+    out.put('}');
+  }
+  out.put('\n');
+}
@@ -0,0 +1,66 @@
+// bulk_export.hpp
+#ifndef BULK_EXPORT_HPP
+#define BULK_EXPORT_HPP
+
+#include "lms_project.hpp"
+
+/*
+ Writing the catalog out for other systems, a book at a time:
+
+   CSV          a title,author,isbn header row, then one row per book;
+                fields holding a comma or quote are quoted (RFC 4180).
+                Line breaks inside fields become spaces, as bulk_import.hpp
+                takes no quoted field across lines, so it reads the file
+                back.
+   JSON Lines   {"title":...,"author":...,"isbn":...} per line.
+   TSV          title, author and isbn separated by tabs, no header; tabs
+                and line breaks inside fields become spaces.
+   archive      the boost text archive, as Library::importText reads it.
+                It is version 1 (see library.hpp), which builds from
+                before that version cannot load.
+
+ Everything goes through a FileWriter, a streambuf with one fixed buffer
+ that is written out with write(2) whenever it fills, so an export needs
+ the same memory for ten books as for ten million.
+ */
+enum ExportFormat { exportCSV, exportJSONLines, exportTSV, exportArchive };
+
+// from the extension: .csv, .jsonl/.ndjson/.json, .tsv, .txt; false if none
+bool exportFormatFor(const std::string &path, ExportFormat &format);
+
+class FileWriter : public std::streambuf {
+public:
+  FileWriter() = default;
+  FileWriter(const FileWriter &) = delete;
+  FileWriter &operator=(const FileWriter &) = delete;
+  ~FileWriter() override;
+  bool open(const std::string &path); // creates or truncates
+  bool attach(int descriptor);        // e.g. 1 for stdout; left open
+  bool close();                       // false if any write failed
+  bool flush() { return fd >= 0 && drain(); }
+  void put(std::string_view s);
+  void put(char ch);
+
+protected:
+  int_type overflow(int_type ch) override;
+  std::streamsize xsputn(const char *s, std::streamsize n) override;
+  int sync() override;
+
+private:
+  bool drain();
+
+  static const ul bufferSize = 1 << 20;
+
+  std::unique_ptr<char[]> buffer;
+  int fd = -1;
+  bool owned = false; // close fd on close()
+  bool failed = false;
+};
+
+// the CSV header row, for formats that have one
+void writeHeader(FileWriter &out, ExportFormat format);
+// one book as a CSV row, a JSON line or a TSV line
+void writeRecord(FileWriter &out, ExportFormat format, std::string_view title,
+                 std::string_view author, std::string_view isbn);
+
+#endif // BULK_EXPORT_HPP
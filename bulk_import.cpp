@@ -0,0 +1,544 @@
+// bulk_import.cpp
+
+#include "bulk_import.hpp"
+#include "isbn.hpp"
+#include "lms_project.hpp"
+#include "text.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+
+const ul minChunkBytes = 1 << 20;
+const char marcEnd = 0x1d;      // record terminator
+const char marcFieldEnd = 0x1e; // field terminator
+const char marcSubfield = 0x1f; // subfield delimiter
+
+std::string_view own(ImportChunk &chunk, std::string s) {
+  chunk.owned.emplace_back(std::move(s));
+  return chunk.owned.back();
+}
+
+std::string_view trim(std::string_view s, std::string_view junk = " \t") {
+  ul first(s.find_first_not_of(junk));
+  if (first == std::string_view::npos) {
+    return std::string_view();
+  }
+  return s.substr(first, s.find_last_not_of(junk) - first + 1);
+}
+
+// checks a record's fields and queues the book, or notes why not
+void addRecord(ImportChunk &chunk, ul where, std::string_view title,
+               std::string_view author, std::string_view isbn) {
+  title = trim(title);
+  author = trim(author);
+  isbn = trim(isbn);
+  ImportedBook b;
+  if (title.empty()) {
+    chunk.problems.push_back({where, "no title"});
+    return;
+  }
+  if (!parseISBN(isbn, b.key)) {
+    chunk.problems.push_back(
+        {where, "\"" + std::string(isbn) + "\" is not a valid ISBN"});
+    return;
+  }
+  std::string titleKey(foldText(title)), authorKey(foldText(author));
+  b.title = title;
+  b.author = author;
+  b.isbn = isbn;
+  b.titleKey = titleKey == title ? title : own(chunk, std::move(titleKey));
+  b.authorKey =
+      authorKey == author ? author : own(chunk, std::move(authorKey));
+  b.where = where;
+  chunk.books.push_back(b);
+}
+
+/*
+ splits a CSV line into fields. Quoted fields with "" in them are copied
+ into the chunk with the quotes undoubled; the rest are views of line.
+ false when a quote is not closed or is followed by something other than
+ a comma.
+ */
+bool splitCSV(std::string_view line, ImportChunk &chunk,
+              std::vector<std::string_view> &fields) {
+  fields.clear();
+  ul i(0), n(line.size());
+  while (true) {
+    if (i < n && line[i] == '"') {
+      ul j(i + 1), q;
+      bool doubled(false);
+      while (true) {
+        q = line.find('"', j);
+        if (q == std::string_view::npos) {
+          return false;
+        }
+        if (q + 1 < n && line[q + 1] == '"') {
+          doubled = true;
+          j = q + 2;
+          continue;
+        }
+        break;
+      }
+      std::string_view raw(line.substr(i + 1, q - i - 1));
+      if (doubled) {
+        std::string s;
+        s.reserve(raw.size());
+        for (ul k = 0; k < raw.size(); k++) {
+          s.push_back(raw[k]);
+          k += raw[k] == '"'; // skip the second quote of a pair
+        }
+        fields.push_back(own(chunk, std::move(s)));
+      } else {
+        fields.push_back(raw);
+      }
+      i = q + 1;
+      if (i < n && line[i] != ',') {
+        return false;
+      }
+    } else {
+      ul c(line.find(',', i));
+      c = c == std::string_view::npos ? n : c;
+      fields.push_back(line.substr(i, c - i));
+      i = c;
+    }
+    if (i >= n) {
+      return true;
+    }
+    i++; // the comma
+  }
+}
+
+void appendUTF8(std::string &s, uint32_t cp) {
+  if (cp < 0x80) {
+    s.push_back(char(cp));
+  } else if (cp < 0x800) {
+    s.push_back(char(0xc0 | cp >> 6));
+    s.push_back(char(0x80 | (cp & 0x3f)));
+  } else if (cp < 0x10000) {
+    s.push_back(char(0xe0 | cp >> 12));
+    s.push_back(char(0x80 | (cp >> 6 & 0x3f)));
+    s.push_back(char(0x80 | (cp & 0x3f)));
+  } else {
+    s.push_back(char(0xf0 | cp >> 18));
+    s.push_back(char(0x80 | (cp >> 12 & 0x3f)));
+    s.push_back(char(0x80 | (cp >> 6 & 0x3f)));
+    s.push_back(char(0x80 | (cp & 0x3f)));
+  }
+}
+
+// just enough JSON to read one object per line
+class JsonLine {
+public:
+  JsonLine(std::string_view line, ImportChunk &chunk)
+      : s(line), chunk(chunk) {}
+
+  // the object's title, author and isbn; false if the line is not an object
+  bool fields(std::string_view &title, std::string_view &author,
+              std::string_view &isbn) {
+    space();
+    if (!take('{')) {
+      return false;
+    }
+    space();
+    if (!take('}')) {
+      do {
+        std::string_view name, value;
+        space();
+        if (!string(name)) {
+          return false;
+        }
+        space();
+        if (!take(':')) {
+          return false;
+        }
+        space();
+        std::string_view *into(name == "title"    ? &title
+                               : name == "author" ? &author
+                               : name == "isbn"   ? &isbn
+                                                  : nullptr);
+        if (into && at < s.size() && s[at] == '"') {
+          if (!string(*into)) {
+            return false;
+          }
+        } else if (into && scalar(value)) {
+          *into = value == "null" ? std::string_view() : value;
+        } else if (!skip()) {
+          return false;
+        }
+        space();
+      } while (take(','));
+      if (!take('}')) {
+        return false;
+      }
+    }
+    space();
+    return at == s.size();
+  }
+
+private:
+  void space() {
+    while (at < s.size() &&
+           (s[at] == ' ' || s[at] == '\t' || s[at] == '\r')) {
+      at++;
+    }
+  }
+
+  bool take(char ch) {
+    if (at < s.size() && s[at] == ch) {
+      at++;
+      return true;
+    }
+    return false;
+  }
+
+  bool hex4(uint32_t &cp) {
+    if (at + 4 > s.size()) {
+      return false;
+    }
+    cp = 0;
+    for (int i = 0; i < 4; i++) {
+      char ch(s[at++]);
+      int d(ch >= '0' && ch <= '9'   ? ch - '0'
+            : ch >= 'a' && ch <= 'f' ? ch - 'a' + 10
+            : ch >= 'A' && ch <= 'F' ? ch - 'A' + 10
+                                     : -1);
+      if (d < 0) {
+        return false;
+      }
+      cp = cp << 4 | d;
+    }
+    return true;
+  }
+
+  // a string without escapes is a view of the line, otherwise a copy
+  bool string(std::string_view &out) {
+    if (!take('"')) {
+      return false;
+    }
+    ul start(at);
+    while (at < s.size() && s[at] != '"' && s[at] != '\\') {
+      at++;
+    }
+    if (at < s.size() && s[at] == '"') {
+      out = s.substr(start, at++ - start);
+      return true;
+    }
+    std::string text(s.substr(start, at - start));
+    while (at < s.size() && s[at] != '"') {
+      char ch(s[at++]);
+      if (ch != '\\') {
+        text.push_back(ch);
+        continue;
+      }
+      if (at == s.size()) {
+        return false;
+      }
+      ch = s[at++];
+      const char *plain("\"\\/bfnrt"), *meant("\"\\/\b\f\n\r\t");
+      const char *p(std::strchr(plain, ch));
+      if (p && ch) {
+        text.push_back(meant[p - plain]);
+        continue;
+      }
+      uint32_t cp;
+      if (ch != 'u' || !hex4(cp)) {
+        return false;
+      }
+      if (cp >= 0xd800 && cp < 0xdc00) { // a surrogate pair
+        uint32_t low;
+        if (!take('\\') || !take('u') || !hex4(low) || low < 0xdc00 ||
+            low >= 0xe000) {
+          return false;
+        }
+        cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+      }
+      appendUTF8(text, cp);
+    }
+    if (!take('"')) {
+      return false;
+    }
+    out = own(chunk, std::move(text));
+    return true;
+  }
+
+  // a number, true, false or null, as written
+  bool scalar(std::string_view &out) {
+    if (at == s.size() || s[at] == '{' || s[at] == '[' || s[at] == '"') {
+      return false;
+    }
+    ul start(at);
+    while (at < s.size() && std::strchr(",}] \t\r", s[at]) == nullptr) {
+      at++;
+    }
+    out = s.substr(start, at - start);
+    return at > start;
+  }
+
+  // any value, nested or not
+  bool skip() {
+    std::string_view ignored;
+    if (at < s.size() && s[at] == '"') {
+      return string(ignored);
+    }
+    if (!take('{') && !take('[')) {
+      return scalar(ignored);
+    }
+    char close(s[at - 1] == '{' ? '}' : ']');
+    space();
+    if (take(close)) {
+      return true;
+    }
+    do {
+      space();
+      if (close == '}') {
+        if (!string(ignored)) {
+          return false;
+        }
+        space();
+        if (!take(':')) {
+          return false;
+        }
+        space();
+      }
+      if (!skip()) {
+        return false;
+      }
+      space();
+    } while (take(','));
+    return take(close);
+  }
+
+  std::string_view s;
+  ImportChunk &chunk;
+  ul at = 0;
+};
+
+// the number written in s's digits; false if it has anything else
+bool digits(std::string_view s, ul &n) {
+  n = 0;
+  for (char ch : s) {
+    if (ch < '0' || ch > '9') {
+      return false;
+    }
+    n = n * 10 + (ch - '0');
+  }
+  return true;
+}
+
+// subfield code of a MARC data field, without its delimiter
+std::string_view subfield(std::string_view field, char code) {
+  for (ul i = field.find(marcSubfield); i != std::string_view::npos;
+       i = field.find(marcSubfield, i + 1)) {
+    if (i + 1 < field.size() && field[i + 1] == code) {
+      ul end(field.find(marcSubfield, i + 2));
+      return field.substr(i + 2, end == std::string_view::npos
+                                     ? std::string_view::npos
+                                     : end - i - 2);
+    }
+  }
+  return std::string_view();
+}
+
+// one MARC record, terminator included
+void parseMARC(std::string_view rec, ul where, ImportChunk &chunk) {
+  ul base;
+  if (rec.size() < 25 || !digits(rec.substr(12, 5), base) || base < 25 ||
+      base > rec.size()) {
+    chunk.problems.push_back({where, "bad MARC leader"});
+    return;
+  }
+  std::string_view title, author, corporate, isbn;
+  // directory entries: tag (3), field length (4), offset from base (5)
+  for (ul e = 24; e + 12 < base; e += 12) {
+    std::string_view tag(rec.substr(e, 3));
+    ul length, offset;
+    if (!digits(rec.substr(e + 3, 4), length) ||
+        !digits(rec.substr(e + 7, 5), offset) ||
+        base + offset + length > rec.size()) {
+      chunk.problems.push_back({where, "bad MARC directory"});
+      return;
+    }
+    std::string_view field(rec.substr(base + offset, length));
+    if (!field.empty() && field.back() == marcFieldEnd) {
+      field.remove_suffix(1);
+    }
+    if (tag == "245" && title.empty()) {
+      title = subfield(field, 'a');
+    } else if (tag == "100" && author.empty()) {
+      author = subfield(field, 'a');
+    } else if (tag == "110" && corporate.empty()) {
+      corporate = subfield(field, 'a');
+    } else if (tag == "020" && isbn.empty()) {
+      isbn = subfield(field, 'a');
+      isbn = isbn.substr(0, isbn.find(' ')); // drop "(pbk.)" and the like
+    }
+  }
+  // cataloguers end fields with ISBD punctuation ahead of the next one
+  addRecord(chunk, where, trim(title, " /:;,="),
+            trim(author.empty() ? corporate : author, " /:;,="), isbn);
+}
+
+} // namespace
+
+bool importFormatFor(const std::string &path, ImportFormat &format) {
+  ul dot(path.rfind('.'));
+  if (dot == std::string::npos) {
+    return false;
+  }
+  std::string ext(foldText(path.substr(dot + 1)));
+  if (ext == "csv") {
+    format = importCSV;
+  } else if (ext == "jsonl" || ext == "ndjson" || ext == "json") {
+    format = importJSONLines;
+  } else if (ext == "mrc" || ext == "marc") {
+    format = importMARC;
+  } else if (ext == "txt") {
+    format = importTextArchive;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool BulkReader::open(const std::string &path, ImportFormat f) {
+  if (f == importTextArchive || !file.open(path)) {
+    return false;
+  }
+  format = f;
+  bodyStart = 0;
+  headerLines = 0;
+  columns[0] = 0;
+  columns[1] = 1;
+  columns[2] = 2;
+  std::string_view data(file.data(), file.size());
+  if (format != importMARC && data.substr(0, 3) == "\xef\xbb\xbf") {
+    bodyStart = 3; // UTF-8 byte order mark
+  }
+  if (format == importCSV) {
+    // a header row names the columns wanted
+    ul end(data.find('\n', bodyStart));
+    std::string_view line(trim(
+        data.substr(bodyStart, end == std::string_view::npos
+                                   ? std::string_view::npos
+                                   : end - bodyStart),
+        "\r"));
+    ImportChunk scratch;
+    std::vector<std::string_view> fields;
+    int named[3] = {-1, -1, -1};
+    if (splitCSV(line, scratch, fields)) {
+      for (ul i = 0; i < fields.size(); i++) {
+        std::string name(foldText(fields[i]));
+        int c(name == "title"    ? 0
+              : name == "author" ? 1
+              : name == "isbn"   ? 2
+                                 : -1);
+        if (c >= 0 && named[c] < 0) {
+          named[c] = i;
+        }
+      }
+    }
+    if (named[0] >= 0 || named[1] >= 0 || named[2] >= 0) {
+      std::copy_n(named, 3, columns);
+      bodyStart = end == std::string_view::npos ? data.size() : end + 1;
+      headerLines = 1;
+    }
+  }
+  return true;
+}
+
+/*
+ cuts the body into chunks of at least minChunkBytes, a few per thread,
+ each ending just after a line break (MARC: a record terminator), parses
+ them in parallel, then turns each chunk's line numbers into file-wide
+ ones.
+ */
+void BulkReader::parse(std::vector<ImportChunk> &chunks) const {
+  chunks.clear();
+  const char *data(file.data());
+  ul size(file.size());
+  char cut(format == importMARC ? marcEnd : '\n');
+  ThreadPool &pool(workerPool());
+  ul want(std::max(minChunkBytes, (size - bodyStart) / (pool.size() * 4)));
+  std::vector<ul> starts{bodyStart};
+  while (size - starts.back() > want) {
+    ul from(starts.back() + want);
+    const void *at(std::memchr(data + from, cut, size - from));
+    if (at == nullptr) {
+      break;
+    }
+    ul next(static_cast<const char *>(at) - data + 1);
+    if (next >= size) {
+      break;
+    }
+    starts.push_back(next);
+  }
+  starts.push_back(size);
+  chunks.resize(starts.size() - 1);
+  pool.run(chunks.size(), [&](ul i) {
+    parseChunk(starts[i], starts[i + 1], chunks[i]);
+  });
+
+  ul before(headerLines);
+  for (ImportChunk &chunk : chunks) {
+    for (ImportedBook &b : chunk.books) {
+      b.where += before;
+    }
+    for (ImportProblem &p : chunk.problems) {
+      p.where += before;
+    }
+    before += chunk.records;
+  }
+}
+
+// parses [first, last) of the file; numbers records from 1
+void BulkReader::parseChunk(ul first, ul last, ImportChunk &chunk) const {
+  std::string_view body(file.data() + first, last - first);
+  if (format == importMARC) {
+    while (!body.empty()) {
+      ul where(++chunk.records), length;
+      ul end(body.find(marcEnd));
+      if (body.size() >= 5 && digits(body.substr(0, 5), length) &&
+          length <= body.size() && length > 0 && body[length - 1] == marcEnd) {
+        end = length - 1; // trust the leader when it agrees
+      }
+      if (end == std::string_view::npos) {
+        chunk.problems.push_back({where, "MARC record is cut short"});
+        return;
+      }
+      parseMARC(body.substr(0, end + 1), where, chunk);
+      body.remove_prefix(end + 1);
+    }
+    return;
+  }
+  std::vector<std::string_view> fields;
+  while (!body.empty()) {
+    ul where(++chunk.records);
+    ul end(body.find('\n'));
+    std::string_view line(body.substr(0, end));
+    body.remove_prefix(end == std::string_view::npos ? body.size() : end + 1);
+    if (!line.empty() && line.back() == '\r') {
+      line.remove_suffix(1);
+    }
+    if (trim(line).empty()) {
+      continue; // blank lines are not records
+    }
+    if (format == importJSONLines) {
+      std::string_view title, author, isbn;
+      if (JsonLine(line, chunk).fields(title, author, isbn)) {
+        addRecord(chunk, where, title, author, isbn);
+      } else {
+        chunk.problems.push_back({where, "not a JSON object"});
+      }
+      continue;
+    }
+    if (!splitCSV(line, chunk, fields)) {
+      chunk.problems.push_back({where, "unbalanced quotes"});
+      continue;
+    }
+    auto column = [&fields](int c) {
+      return c >= 0 && ul(c) < fields.size() ? fields[c] : std::string_view();
+    };
+    addRecord(chunk, where, column(columns[0]), column(columns[1]),
+              column(columns[2]));
+  }
+}
@@ -0,0 +1,87 @@
+// bulk_import.hpp
+#ifndef BULK_IMPORT_HPP
+#define BULK_IMPORT_HPP
+
+#include "catalog_file.hpp"
+#include "lms_project.hpp"
+
+/*
+ Reading books in bulk from files other systems write:
+
+   CSV          RFC 4180: comma separated fields, optionally in double
+                quotes with "" standing for a quote. A first row naming
+                title, author and isbn columns (any order, any case) picks
+                them out; otherwise the columns are title, author, isbn.
+                A quoted field may not span lines.
+   JSON Lines   one object per line; its "title", "author" and "isbn"
+                members are used, anything else is skipped.
+   MARC 21      binary records (ISO 2709): title from 245 $a, author from
+                100 $a or else 110 $a, ISBN from 020 $a. Text is taken to
+                be UTF-8 (leader/09 'a').
+
+ The file is mapped and cut into chunks at record boundaries, and the
+ chunks are parsed on workerPool() (see thread_pool.hpp). Each record's
+ ISBN is checked and its title and author folded (see text.hpp) right
+ there, so the caller is left with the inserts. Nothing is interned:
+ fields are views into the mapping, or into their chunk when they had to
+ be unescaped, so the BulkReader and the chunks must outlive the views.
+ */
+/*
+ importTextArchive is the boost text archive exportFile writes. It is not
+ parsed here: Library::importText reads it, replacing the whole catalog.
+ */
+enum ImportFormat { importCSV, importJSONLines, importMARC, importTextArchive };
+
+// from the extension: .csv, .jsonl/.ndjson/.json, .mrc/.marc, .txt; false if
+// none
+bool importFormatFor(const std::string &path, ImportFormat &format);
+
+struct ImportedBook {
+  std::string_view title;
+  std::string_view author;
+  std::string_view isbn;
+  std::string_view titleKey;  // foldText(title)
+  std::string_view authorKey; // foldText(author)
+  uint64_t key;               // ISBN-13, see isbn.hpp
+  ul where;                   // line or record number in the file, from 1
+};
+
+struct ImportProblem {
+  ul where;
+  std::string what;
+};
+
+struct ImportChunk {
+  std::vector<ImportedBook> books;
+  std::vector<ImportProblem> problems; // malformed records, in file order
+  ul records = 0;                      // lines or records the chunk spans
+  std::deque<std::string> owned;       // unescaped text the views point at
+};
+
+// what Library::importFile did with a file
+struct ImportReport {
+  ul added = 0;
+  ul duplicates = 0; // ISBN already in the catalog or earlier in the file
+  ul malformed = 0;
+  vString problems; // the first few skipped, e.g. "line 12: no title"
+};
+
+class BulkReader {
+public:
+  bool open(const std::string &path, ImportFormat format);
+  // "line" or "record", for reports
+  const char *unit() const { return format == importMARC ? "record" : "line"; }
+  // parses the whole file; chunks come back in file order
+  void parse(std::vector<ImportChunk> &chunks) const;
+
+private:
+  void parseChunk(ul first, ul last, ImportChunk &chunk) const;
+
+  MappedFile file;
+  ImportFormat format = importCSV;
+  ul bodyStart = 0;           // past a UTF-8 BOM and a CSV header row
+  ul headerLines = 0;         // 1 when there is a header row
+  int columns[3] = {0, 1, 2}; // CSV title, author, isbn; -1 when absent
+};
+
+#endif // BULK_IMPORT_HPP
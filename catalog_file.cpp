@@ -0,0 +1,292 @@
+// catalog_file.cpp
+
+#include "catalog_file.hpp"
+#include "book.hpp"
+#include "isbn.hpp"
+#include "lms_project.hpp"
+#include "text.hpp"
+#include "trace.hpp"
+
+MappedFile::~MappedFile() { close(); }
+
+bool MappedFile::open(const std::string &path) {
+  close();
+  int fd(::open(path.c_str(), O_RDONLY));
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    ::close(fd);
+    return false;
+  }
+  void *p(mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0));
+  ::close(fd); // the mapping keeps the file alive
+  if (p == MAP_FAILED) {
+    return false;
+  }
+  base = static_cast<const char *>(p);
+  length = st.st_size;
+  return true;
+}
+
+void MappedFile::close() {
+  if (base) {
+    munmap(const_cast<char *>(base), length);
+    base = nullptr;
+    length = 0;
+  }
+}
+
+bool CatalogReader::open(const std::string &path) {
+  close();
+  file = std::make_shared<MappedFile>();
+  if (!file->open(path) || file->size() < sizeof(CatalogHeader)) {
+    file.reset();
+    return false;
+  }
+  auto h(reinterpret_cast<const CatalogHeader *>(file->data()));
+  if (std::memcmp(h->magic, catalogMagic, sizeof(catalogMagic)) != 0 ||
+      h->version != catalogVersion || h->byteOrder != catalogByteOrder) {
+    file.reset();
+    return false;
+  }
+  // offsets are compared against what is left after them, so a corrupt
+  // header cannot wrap a sum around and pass
+  ul size(file->size());
+  ul recordBytes(h->bookCount * sizeof(CatalogRecord));
+  if (h->bookCount > size / sizeof(CatalogRecord) ||
+      h->recordsOffset > size || recordBytes > size - h->recordsOffset ||
+      h->heapOffset > size || h->heapSize > size - h->heapOffset ||
+      h->ordersOffset % alignof(uint32_t) != 0 || h->ordersOffset > size ||
+      orderCount * h->bookCount * sizeof(uint32_t) > size - h->ordersOffset) {
+    file.reset();
+    return false;
+  }
+  records =
+      reinterpret_cast<const CatalogRecord *>(file->data() + h->recordsOffset);
+  heap = file->data() + h->heapOffset;
+  orders = reinterpret_cast<const uint32_t *>(file->data() + h->ordersOffset);
+  header = h;
+  return true;
+}
+
+void CatalogReader::close() {
+  header = nullptr;
+  records = nullptr;
+  heap = nullptr;
+  orders = nullptr;
+  file.reset(); // the mapping goes once nothing else retains it
+}
+
+std::string_view CatalogReader::field(const CatalogField &f) const {
+  if (ul(f.offset) + f.length > header->heapSize) {
+    return std::string_view();
+  }
+  return std::string_view(heap + f.offset, f.length);
+}
+
+std::string_view CatalogReader::key(CatalogOrder o, ul i) const {
+  return o == orderISBN ? isbn(i) : o == orderAuthor ? author(i) : title(i);
+}
+
+ul CatalogReader::ordered(CatalogOrder o, ul i) const {
+  ul r(orders[o * header->bookCount + i]);
+  return r < header->bookCount ? r : header->bookCount;
+}
+
+namespace {
+
+// [first, last) of the positions 0..n whose keyAt() equals key
+template <class KeyAt, class Key>
+void bounds(ul n, KeyAt keyAt, const Key &key, ul &first, ul &last) {
+  ul lo(0), hi(n);
+  while (lo < hi) { // lower bound
+    ul mid(lo + (hi - lo) / 2);
+    if (keyAt(mid) < key) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  first = lo;
+  hi = n;
+  while (lo < hi) { // upper bound
+    ul mid(lo + (hi - lo) / 2);
+    if (key < keyAt(mid)) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  last = lo;
+}
+
+// writes all of data to fd, resuming after short writes
+bool writeAll(int fd, const void *data, ul size) {
+  auto p(static_cast<const char *>(data));
+  while (size > 0) {
+    ssize_t n(write(fd, p, size));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+// makes a rename or create in the directory holding path durable
+bool syncDirectoryOf(const std::string &path) {
+  ul slash(path.rfind('/'));
+  std::string dir(slash == std::string::npos ? "."
+                  : slash == 0               ? "/"
+                                             : path.substr(0, slash));
+  int fd(::open(dir.c_str(), O_RDONLY | O_DIRECTORY));
+  if (fd < 0) {
+    return false;
+  }
+  bool synced(fsync(fd) == 0);
+  ::close(fd);
+  return synced;
+}
+
+} // namespace
+
+/*
+ [first, last) are the positions in order o whose key equals key. The ISBN
+ order is sorted on catalogKey(), so any spelling of an ISBN matches; the
+ others on foldText(), so case, accents and spacing do not matter. The
+ query is folded once; each step folds its key into one reused buffer.
+ */
+void CatalogReader::equalRange(CatalogOrder o, std::string_view key,
+                               ul &first, ul &last) const {
+  first = last = 0;
+  if (o == orderISBN) {
+    auto keyAt = [&](ul pos) {
+      ul r(ordered(o, pos));
+      return r < size() ? catalogKey(isbn(r)) : 0;
+    };
+    bounds(size(), keyAt, catalogKey(key), first, last);
+  } else {
+    std::string folded(foldText(key)), scratch;
+    auto keyAt = [&](ul pos) {
+      ul r(ordered(o, pos));
+      foldTextInto(r < size() ? this->key(o, r) : std::string_view(),
+                   scratch);
+      return std::string_view(scratch);
+    };
+    bounds(size(), keyAt, std::string_view(folded), first, last);
+  }
+}
+
+// [first, last) are the positions in order o whose key starts with prefix
+void CatalogReader::prefixRange(CatalogOrder o, std::string_view prefix,
+                                ul &first, ul &last) const {
+  first = last = 0;
+  // cutting every key to the prefix's length keeps the order sorted
+  std::string folded(foldText(prefix)), scratch;
+  auto keyAt = [&](ul pos) {
+    ul r(ordered(o, pos));
+    foldTextInto(r < size() ? this->key(o, r) : std::string_view(), scratch);
+    return std::string_view(scratch).substr(0, folded.size());
+  };
+  bounds(size(), keyAt, std::string_view(folded), first, last);
+}
+
+/*
+ writes books to path in the binary catalog layout. The file is written next
+ to path and renamed over it, so readers (and existing mappings) never see a
+ half-written catalog. The file is fsynced before the rename and its
+ directory after, so once this returns true the new catalog survives a
+ crash and the journal it replaces may be emptied.
+ */
+bool writeCatalog(const std::string &path, const umB &books) {
+  TraceSpan span("writeCatalog");
+  std::string heap;
+  std::unordered_map<std::string_view, uint32_t> offsets;
+  std::vector<CatalogRecord> records;
+  records.reserve(books.size());
+
+  auto place = [&](std::string_view s) {
+    auto it(offsets.find(s));
+    if (it != offsets.end()) {
+      return CatalogField{it->second, uint32_t(s.size())};
+    }
+    uint32_t offset(heap.size());
+    heap.append(s);
+    offsets.emplace(s, offset);
+    return CatalogField{offset, uint32_t(s.size())};
+  };
+
+  for (const auto &aPair : books) {
+    const Book &b(aPair.second);
+    records.push_back({place(b.getTitleView()), place(b.getAuthorView()),
+                       place(b.getISBNView())});
+  }
+  if (heap.size() > UINT32_MAX || records.size() > UINT32_MAX) {
+    return false;
+  }
+
+  std::vector<uint32_t> orders(orderCount * records.size());
+  std::vector<uint64_t> isbnKeys;
+  for (const auto &aPair : books) {
+    isbnKeys.emplace_back(aPair.first);
+  }
+  std::vector<std::string_view> folded[orderCount];
+  for (const auto &aPair : books) {
+    folded[orderAuthor].push_back(aPair.second.getAuthorKey());
+    folded[orderTitle].push_back(aPair.second.getTitleKey());
+  }
+  for (int o = 0; o < orderCount; o++) {
+    auto keyOf = [&](uint32_t r) { return folded[o][r]; };
+    auto first(orders.begin() + o * records.size());
+    auto last(first + records.size());
+    std::iota(first, last, 0);
+    if (o == orderISBN) {
+      std::sort(first, last, [&](uint32_t a, uint32_t b) {
+        return isbnKeys[a] == isbnKeys[b] ? a < b : isbnKeys[a] < isbnKeys[b];
+      });
+      continue;
+    }
+    std::sort(first, last, [&](uint32_t a, uint32_t b) {
+      // ties in ISBN order, as Library's own orders have them
+      std::string_view ka(keyOf(a)), kb(keyOf(b));
+      return ka == kb ? isbnKeys[a] < isbnKeys[b] : ka < kb;
+    });
+  }
+
+  CatalogHeader header;
+  std::memcpy(header.magic, catalogMagic, sizeof(catalogMagic));
+  header.version = catalogVersion;
+  header.byteOrder = catalogByteOrder;
+  header.bookCount = records.size();
+  header.recordsOffset = sizeof(CatalogHeader);
+  header.heapOffset =
+      header.recordsOffset + records.size() * sizeof(CatalogRecord);
+  header.heapSize = heap.size();
+  header.ordersOffset = (header.heapOffset + heap.size() + 3) & ~ul(3);
+
+  std::string tmpPath(path + ".tmp");
+  int fd(::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644));
+  if (fd < 0) {
+    return false;
+  }
+  bool written(
+      writeAll(fd, &header, sizeof(header)) &&
+      writeAll(fd, records.data(), records.size() * sizeof(CatalogRecord)) &&
+      writeAll(fd, heap.data(), heap.size()) &&
+      writeAll(fd, "\0\0\0",
+               header.ordersOffset - header.heapOffset - heap.size()) &&
+      writeAll(fd, orders.data(), orders.size() * sizeof(uint32_t)) &&
+      fsync(fd) == 0);
+  written = ::close(fd) == 0 && written;
+  if (!written || std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+    std::remove(tmpPath.c_str());
+    return false;
+  }
+  return syncDirectoryOf(path);
+}
@@ -0,0 +1,102 @@
+// catalog_file.hpp
+#ifndef CATALOG_FILE_HPP
+#define CATALOG_FILE_HPP
+
+#include "lms_project.hpp"
+
+/*
+ Binary catalog layout (host byte order):
+
+   CatalogHeader
+   CatalogRecord[bookCount]   fixed size, one per book
+   string heap                every distinct string stored once, no NULs
+   uint32_t[3][bookCount]     record numbers sorted by ISBN key (see
+                              isbn.hpp), folded author and folded title
+                              (see text.hpp), equal keys in ISBN order
+
+ A record refers to its title, author and ISBN by (offset, length) into the
+ heap, so loading needs no per-field parsing, only bounds checks. The sorted
+ orders let a reader search the mapping in place without building indexes.
+ */
+const char catalogMagic[8] = {'L', 'M', 'S', 'C', 'A', 'T', 0, 0};
+const uint32_t catalogVersion = 1;
+const uint32_t catalogByteOrder = 0x01020304;
+
+struct CatalogHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint64_t bookCount;
+  uint64_t recordsOffset;
+  uint64_t heapOffset;
+  uint64_t heapSize;
+  uint64_t ordersOffset;
+};
+
+enum CatalogOrder { orderISBN, orderAuthor, orderTitle, orderCount };
+
+struct CatalogField {
+  uint32_t offset;
+  uint32_t length;
+};
+
+struct CatalogRecord {
+  CatalogField title;
+  CatalogField author;
+  CatalogField isbn;
+};
+
+// read-only memory mapping of a whole file, unmapped on destruction
+class MappedFile {
+public:
+  MappedFile() = default;
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  ~MappedFile();
+  bool open(const std::string &path);
+  void close();
+  const char *data() const { return base; }
+  ul size() const { return length; }
+
+private:
+  const char *base = nullptr;
+  ul length = 0;
+};
+
+/*
+ view of a binary catalog file. Only the header is checked on open; fields
+ are bounds-checked as they are read (an out of range field reads as
+ empty), so opening touches no pages beyond the header.
+ */
+class CatalogReader {
+public:
+  bool open(const std::string &path);
+  void close();
+  bool isOpen() const { return header != nullptr; }
+  ul size() const { return header ? header->bookCount : 0; }
+  std::string_view title(ul i) const { return field(records[i].title); }
+  std::string_view author(ul i) const { return field(records[i].author); }
+  std::string_view isbn(ul i) const { return field(records[i].isbn); }
+  std::string_view key(CatalogOrder o, ul i) const;
+  // keeps the mapping (and every view into it) alive past this reader
+  std::shared_ptr<const MappedFile> storage() const { return file; }
+  // record number of the i-th book in order o; size() if the entry is bad
+  ul ordered(CatalogOrder o, ul i) const;
+  void equalRange(CatalogOrder o, std::string_view key, ul &first,
+                  ul &last) const;
+  void prefixRange(CatalogOrder o, std::string_view prefix, ul &first,
+                   ul &last) const;
+
+private:
+  std::string_view field(const CatalogField &f) const;
+
+  std::shared_ptr<MappedFile> file;
+  const CatalogHeader *header = nullptr;
+  const CatalogRecord *records = nullptr;
+  const char *heap = nullptr;
+  const uint32_t *orders = nullptr;
+};
+
+bool writeCatalog(const std::string &path, const umB &books);
+
+#endif // CATALOG_FILE_HPP
@@ -0,0 +1,492 @@
+// cli.cpp
+
+#include "cli.hpp"
+#include "client.hpp"
+#include "library.hpp"
+#include "metrics.hpp"
+#include "protocol.hpp"
+#include "server.hpp"
+#include "trace.hpp"
+#include "lms_project.hpp"
+
+namespace {
+
+const ul prefixHits(1000);   // most books a prefix query lists
+const ul similarAuthors(10); // most names a similar query lists
+const ul pipelineDepth(256); // batch queries a server is sent ahead
+
+const char *usage =
+    "usage: lms [--kiosk | --connect SOCKET]\n"
+    "       lms search --title T | --author A | --isbn I | --words W\n"
+    "                  | --title-prefix P | --author-prefix P | --grep RE\n"
+    "                  | --similar A  [--csv | --jsonl]\n"
+    "       lms add --title T --author A --isbn I\n"
+    "       lms remove --isbn I\n"
+    "       lms import FILE\n"
+    "       lms export FILE [--order title|author|isbn]\n"
+    "       lms stats\n"
+    "       lms batch [--csv | --jsonl]\n"
+    "       lms serve [--socket SOCKET]\n"
+    "       --connect SOCKET with any but serve asks a running server\n";
+
+struct Options {
+  std::string command;
+  vString operands;                                    // FILE and the like
+  std::unordered_map<std::string, std::string> values; // --name value
+  bool kiosk = false;
+  std::string server; // --connect
+  ExportFormat format = exportTSV;
+};
+
+// false on an option missing its value
+bool parseOptions(int argc, char *argv[], Options &opts) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg(argv[i]);
+    if (arg == "--kiosk") {
+      opts.kiosk = true;
+    } else if (arg == "--csv") {
+      opts.format = exportCSV;
+    } else if (arg == "--jsonl") {
+      opts.format = exportJSONLines;
+    } else if (arg == "--connect") {
+      if (i + 1 == argc) {
+        return false;
+      }
+      opts.server = argv[++i];
+    } else if (arg.rfind("--", 0) == 0) {
+      if (i + 1 == argc) {
+        return false;
+      }
+      opts.values[arg.substr(2)] = argv[++i];
+    } else if (opts.command.empty()) {
+      opts.command = arg;
+    } else {
+      opts.operands.push_back(arg);
+    }
+  }
+  return true;
+}
+
+/*
+ answers one query of the given kind; false (and why) when the kind is
+ unknown or the text is not usable. Books go to out, or for "similar" the
+ author names.
+ */
+bool answer(const Library &aLibrary, std::string_view kind,
+            std::string_view text, ExportFormat format, FileWriter &out,
+            std::string &error) {
+  vpBook results;
+  if (kind == "title") {
+    aLibrary.searchByTitle(text, results);
+  } else if (kind == "author") {
+    aLibrary.searchByAuthor(text, results);
+  } else if (kind == "isbn") {
+    aLibrary.searchByISBN(text, results);
+  } else if (kind == "words") {
+    aLibrary.searchByWords(text, results);
+  } else if (kind == "title-prefix") {
+    aLibrary.searchByTitlePrefix(text, prefixHits, results);
+  } else if (kind == "author-prefix") {
+    aLibrary.searchByAuthorPrefix(text, prefixHits, results);
+  } else if (kind == "grep") {
+    std::regex pattern;
+    try {
+      pattern.assign(text.begin(), text.end(),
+                     std::regex::ECMAScript | std::regex::icase |
+                         std::regex::optimize);
+    } catch (const std::regex_error &) {
+      error = std::string(text) + " is not a valid pattern";
+      return false;
+    }
+    auto found = [&pattern](std::string_view s) {
+      return std::regex_search(s.begin(), s.end(), pattern);
+    };
+    aLibrary.scan(
+        [&found](const Book &b) {
+          return found(b.getTitleView()) || found(b.getAuthorView()) ||
+                 found(b.getISBNView());
+        },
+        results);
+  } else if (kind == "similar") {
+    vSV authors;
+    aLibrary.fuzzyAuthors(text, typosAllowed(text), similarAuthors, authors);
+    for (std::string_view a : authors) {
+      out.put(a);
+      out.put('\n');
+    }
+    return true;
+  } else {
+    error = "unknown query kind " + std::string(kind);
+    return false;
+  }
+  for (const Book *b : results) {
+    writeRecord(out, format, b->getTitleView(), b->getAuthorView(),
+                b->getISBNView());
+  }
+  return true;
+}
+
+int search(Library &aLibrary, const Options &opts) {
+  if (opts.values.size() != 1) {
+    std::cerr << usage;
+    return 2;
+  }
+  FileWriter out;
+  out.attach(STDOUT_FILENO);
+  writeHeader(out, opts.format);
+  std::string error;
+  bool ok(answer(aLibrary, opts.values.begin()->first,
+                 opts.values.begin()->second, opts.format, out, error));
+  out.close();
+  if (!ok) {
+    std::cerr << "lms: " << error << "\n";
+    return error.rfind("unknown", 0) == 0 ? 2 : 1;
+  }
+  return 0;
+}
+
+int batch(Library &aLibrary, const Options &opts) {
+  FileWriter out;
+  out.attach(STDOUT_FILENO);
+  std::ios::sync_with_stdio(false);
+  std::string line, error;
+  ul queries(0);
+  auto started(std::chrono::steady_clock::now());
+  while (std::getline(std::cin, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::string_view query(line);
+    ul space(query.find(' '));
+    std::string_view kind(query.substr(0, space));
+    std::string_view text(space == std::string_view::npos
+                              ? std::string_view()
+                              : query.substr(space + 1));
+    if (!answer(aLibrary, kind, text, opts.format, out, error)) {
+      std::cerr << "lms: " << error << "\n";
+    }
+    out.put('\n'); // the end of this answer
+    queries++;
+    if (std::cin.rdbuf()->in_avail() <= 0) {
+      out.flush(); // nothing more waiting: whoever asked gets the answer
+    }
+  }
+  out.close();
+  double seconds(std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - started)
+                     .count());
+  fprintf(stderr, "%lu queries in %.3f s (%.0f/s)\n", queries, seconds,
+          seconds > 0 ? queries / seconds : 0.0);
+  return 0;
+}
+
+// the request a batch query kind is sent as; false for kinds with none
+bool requestFor(std::string_view kind, Request &code) {
+  static const std::pair<std::string_view, Request> kinds[] = {
+      {"title", reqTitle},
+      {"author", reqAuthor},
+      {"isbn", reqISBN},
+      {"words", reqWords},
+      {"title-prefix", reqTitlePrefix},
+      {"author-prefix", reqAuthorPrefix},
+      {"similar", reqSimilar}};
+  for (const auto &k : kinds) {
+    if (k.first == kind) {
+      code = k.second;
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+ batch against a server. Up to pipelineDepth queries are sent before the
+ first reply is read, so the round trips overlap; as in batch, everything
+ is flushed whenever stdin has nothing more waiting.
+ */
+int batchRemote(const Options &opts) {
+  LibraryClient server;
+  if (!server.connect(opts.server)) {
+    std::cerr << "lms: no server at " << opts.server << "\n";
+    return 1;
+  }
+  FileWriter out;
+  out.attach(STDOUT_FILENO);
+  std::ios::sync_with_stdio(false);
+  std::vector<Request> waiting(pipelineDepth); // the kinds sent, in order
+  ul sent(0), answered(0), queries(0);
+  std::string line;
+  std::string hits(std::to_string(prefixHits));
+  std::string names(std::to_string(similarAuthors));
+  Message reply;
+  auto collect = [&](ul upTo) {
+    for (; answered < upTo; answered++) {
+      if (!server.receive(reply)) {
+        return false;
+      }
+      if (reply.code == statusTooLarge) {
+        std::cerr << "lms: the reply to query " << answered + 1
+                  << " would be too large\n";
+      }
+      const vSV &f(reply.fields);
+      if (waiting[answered % pipelineDepth] == reqSimilar) {
+        for (std::string_view a : f) {
+          out.put(a);
+          out.put('\n');
+        }
+      } else {
+        for (ul i = 0; i + 2 < f.size(); i += 3) {
+          writeRecord(out, opts.format, f[i], f[i + 1], f[i + 2]);
+        }
+      }
+      out.put('\n');
+    }
+    return true;
+  };
+  auto started(std::chrono::steady_clock::now());
+  bool connected(true);
+  while (connected && std::getline(std::cin, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::string_view query(line);
+    ul space(query.find(' '));
+    std::string_view kind(query.substr(0, space));
+    std::string_view text(space == std::string_view::npos
+                              ? std::string_view()
+                              : query.substr(space + 1));
+    Request code;
+    if (!requestFor(kind, code)) {
+      connected = collect(sent); // keep the answers in order
+      if (kind == "grep") {
+        std::cerr << "lms: grep needs the catalog file, not --connect\n";
+      } else {
+        std::cerr << "lms: unknown query kind " << kind << "\n";
+      }
+      out.put('\n');
+      queries++;
+      continue;
+    }
+    std::string typos(std::to_string(typosAllowed(text)));
+    if (code == reqSimilar) {
+      server.send(code, {text, typos, names});
+    } else if (code == reqTitlePrefix || code == reqAuthorPrefix) {
+      server.send(code, {text, hits});
+    } else {
+      server.send(code, {text});
+    }
+    waiting[sent % pipelineDepth] = code;
+    sent++;
+    queries++;
+    if (sent - answered == pipelineDepth) {
+      connected = collect(answered + 1);
+    }
+    if (std::cin.rdbuf()->in_avail() <= 0) {
+      connected = connected && server.flush() && collect(sent);
+      out.flush();
+    }
+  }
+  connected = connected && collect(sent);
+  out.close();
+  if (!connected) {
+    std::cerr << "lms: lost the server at " << opts.server << "\n";
+    return 1;
+  }
+  double seconds(std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - started)
+                     .count());
+  fprintf(stderr, "%lu queries in %.3f s (%.0f/s)\n", queries, seconds,
+          seconds > 0 ? queries / seconds : 0.0);
+  return 0;
+}
+
+int serveOn(Library &aLibrary, const Options &opts) {
+  auto socket(opts.values.find("socket"));
+  std::string path(socket == opts.values.end() ? defaultSocketPath
+                                               : socket->second);
+  fprintf(stderr, "lms: serving %lu books on %s\n", aLibrary.size(),
+          path.c_str());
+  if (!serve(aLibrary, path)) {
+    std::cerr << "lms: could not listen on " << path
+              << " (is another server using it?)\n";
+    return 1;
+  }
+  return 0;
+}
+
+int addOne(Library &aLibrary, Options &opts) {
+  if (!opts.values.count("title") || !opts.values.count("isbn")) {
+    std::cerr << usage;
+    return 2;
+  }
+  if (!aLibrary.addBook(opts.values["title"], opts.values["author"],
+                       opts.values["isbn"])) {
+    uint64_t key;
+    if (parseISBN(opts.values["isbn"], key)) {
+      std::cerr << "lms: could not record the edit; the book was not added\n";
+    } else {
+      std::cerr << "lms: " << opts.values["isbn"]
+                << " is not a valid ISBN-10 or ISBN-13\n";
+    }
+    return 1;
+  }
+  return 0;
+}
+
+int removeOne(Library &aLibrary, Options &opts) {
+  if (!opts.values.count("isbn")) {
+    std::cerr << usage;
+    return 2;
+  }
+  vpBook found;
+  aLibrary.searchByISBN(opts.values["isbn"], found);
+  if (!aLibrary.removeBook(opts.values["isbn"])) {
+    if (found.empty()) {
+      std::cerr << "lms: no book with ISBN " << opts.values["isbn"] << "\n";
+    } else {
+      std::cerr << "lms: could not record the edit; the book was not "
+                   "removed\n";
+    }
+    return 1;
+  }
+  return 0;
+}
+
+int importFrom(Library &aLibrary, const Options &opts) {
+  ImportFormat format;
+  if (opts.operands.size() != 1 ||
+      !importFormatFor(opts.operands[0], format)) {
+    std::cerr << usage;
+    return 2;
+  }
+  if (format == importTextArchive) {
+    if (!aLibrary.importText(opts.operands[0])) {
+      std::cerr << "lms: could not read " << opts.operands[0] << "\n";
+      return 1;
+    }
+    printf("replaced the catalog with %lu books\n", aLibrary.size());
+    return 0;
+  }
+  ImportReport report;
+  if (!aLibrary.importFile(opts.operands[0], format, report)) {
+    std::cerr << "lms: could not read " << opts.operands[0] << "\n";
+    return 1;
+  }
+  printf("added %lu, duplicates %lu, malformed %lu\n", report.added,
+         report.duplicates, report.malformed);
+  for (const std::string &p : report.problems) {
+    fprintf(stderr, "%s\n", p.c_str());
+  }
+  return 0;
+}
+
+int exportTo(const Library &aLibrary, const Options &opts) {
+  ExportFormat format;
+  auto order(opts.values.find("order"));
+  std::string by(order == opts.values.end() ? "" : order->second);
+  if (opts.operands.size() != 1 ||
+      !exportFormatFor(opts.operands[0], format) ||
+      (by != "" && by != "title" && by != "author" && by != "isbn")) {
+    std::cerr << usage;
+    return 2;
+  }
+  if (!aLibrary.exportFile(opts.operands[0], format,
+                           by == "title"    ? orderTitle
+                           : by == "author" ? orderAuthor
+                           : by == "isbn"   ? orderISBN
+                                            : orderCount)) {
+    std::cerr << "lms: could not write " << opts.operands[0] << "\n";
+    return 1;
+  }
+  return 0;
+}
+
+int stats(Library &aLibrary) {
+  ul title, author, isbn;
+  aLibrary.fieldWidths(title, author, isbn);
+  printf("books           %lu\n", aLibrary.size());
+  printf("read-only       %s\n", aLibrary.readOnly() ? "yes" : "no");
+  if (!aLibrary.remote()) { // the pool here holds only what was fetched
+    printf("unique strings  %lu\n", aLibrary.stringPool().uniqueStrings());
+    printf("string bytes    %lu\n", aLibrary.stringPool().arenaBytes());
+  }
+  printf("widest title    %lu\n", title);
+  printf("widest author   %lu\n", author);
+  printf("widest isbn     %lu\n", isbn);
+  return 0;
+}
+
+} // namespace
+
+bool isCommandLine(int argc, char *argv[]) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg(argv[i]);
+    if (arg == "--connect" && i + 1 < argc) {
+      i++;
+    } else if (arg != "--kiosk") {
+      return true;
+    }
+  }
+  return false;
+}
+
+int runCommandLine(int argc, char *argv[]) {
+  Options opts;
+  if (!parseOptions(argc, argv, opts)) {
+    std::cerr << usage;
+    return 2;
+  }
+  const std::string &cmd(opts.command);
+  if (cmd == "help") {
+    std::cout << usage;
+    return 0;
+  }
+  bool edits(cmd == "add" || cmd == "remove" || cmd == "import");
+  if (!edits && cmd != "search" && cmd != "batch" && cmd != "export" &&
+      cmd != "stats" && cmd != "serve") {
+    std::cerr << usage;
+    return 2;
+  }
+  if (!opts.server.empty() && cmd == "batch") {
+    return batchRemote(opts);
+  }
+  Library aLibrary;
+  if (!opts.server.empty()) {
+    if (cmd == "serve" || cmd == "import" || cmd == "export") {
+      std::cerr << "lms: " << cmd << " needs the catalog file, not --connect\n";
+      return 2;
+    }
+    if (!aLibrary.connect(opts.server)) {
+      std::cerr << "lms: no server at " << opts.server << "\n";
+      return 1;
+    }
+  } else if (!opts.kiosk || !aLibrary.openReadOnly()) {
+    aLibrary.deserialize();
+  }
+  if (edits && aLibrary.readOnly()) {
+    std::cerr << "lms: the catalog is read-only with --kiosk\n";
+    return 1;
+  }
+  int status(cmd == "serve"    ? serveOn(aLibrary, opts)
+             : cmd == "search" ? search(aLibrary, opts)
+             : cmd == "batch"  ? batch(aLibrary, opts)
+             : cmd == "add"    ? addOne(aLibrary, opts)
+             : cmd == "remove" ? removeOne(aLibrary, opts)
+             : cmd == "import" ? importFrom(aLibrary, opts)
+             : cmd == "export" ? exportTo(aLibrary, opts)
+                               : stats(aLibrary));
+  if (const char *problem = aLibrary.takeRemoteProblem()) {
+    std::cerr << "lms: " << problem << " at " << opts.server << "\n";
+    status = 1;
+  }
+  aLibrary.checkpoint();
+  saveMetrics();
+  saveTrace();
+  return status;
+}
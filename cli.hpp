@@ -0,0 +1,49 @@
+// cli.hpp
+#ifndef CLI_HPP
+#define CLI_HPP
+
+#include "lms_project.hpp"
+
+/*
+ Command line use, without curses, for scripts, cron jobs and timing the
+ engine:
+
+   lms search --title T | --author A | --isbn I | --words W
+              | --title-prefix P | --author-prefix P | --grep RE
+              | --similar A                      [--csv | --jsonl]
+   lms add --title T --author A --isbn I
+   lms remove --isbn I
+   lms import FILE                               (.csv, .jsonl, .mrc, .txt)
+   lms export FILE [--order title|author|isbn]   (.csv, .jsonl, .tsv, .txt)
+   lms stats
+   lms batch [--csv | --jsonl]
+   lms serve [--socket SOCKET]                   (default library_data.sock)
+
+ batch reads one query per line from stdin, "<kind> <text>" with the
+ kinds named as search's options ("author Melville", "words white
+ whale"), and answers each with its result lines followed by an empty
+ line. Output is buffered and flushed whenever stdin has nothing more
+ waiting, so a pipe of queries streams at full speed and a program asking
+ one question at a time still gets each answer at once. The query count
+ and rate go to stderr at the end.
+
+ import adds a file's books to the catalog, except a .txt archive as
+ export writes, which replaces the catalog.
+
+ Results are title<TAB>author<TAB>isbn lines unless --csv or --jsonl is
+ given; --similar lists author names. --kiosk anywhere on the line serves
+ the catalog read-only.
+
+ serve keeps the catalog loaded and answers clients over a Unix domain
+ socket (see server.hpp) until interrupted. --connect SOCKET makes any
+ other command, and the TUI, ask that server instead of loading the
+ catalog; batch then pipelines its queries. import, export and grep
+ queries need the catalog file and are refused with --connect.
+ */
+
+// true when argv holds more than the TUI's own options (--kiosk, --connect)
+bool isCommandLine(int argc, char *argv[]);
+// runs the command in argv; returns the exit status
+int runCommandLine(int argc, char *argv[]);
+
+#endif // CLI_HPP
@@ -0,0 +1,109 @@
+// client.cpp
+
+#include "client.hpp"
+#include "protocol.hpp"
+#include "lms_project.hpp"
+
+namespace {
+
+// a write to a server that has gone must fail, not raise SIGPIPE
+#ifdef MSG_NOSIGNAL
+const int sendFlags(MSG_NOSIGNAL);
+#else
+const int sendFlags(0); // SO_NOSIGPIPE is set on the socket instead
+#endif
+
+} // namespace
+
+bool LibraryClient::connect(const std::string &socketPath) {
+  close();
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (socketPath.size() >= sizeof(address.sun_path)) {
+    return false;
+  }
+  std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return false;
+  }
+#ifdef SO_NOSIGPIPE
+  int on(1);
+  setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+  if (::connect(fd, reinterpret_cast<sockaddr *>(&address),
+                sizeof(address)) != 0) {
+    close();
+    return false;
+  }
+  path = socketPath;
+  return true;
+}
+
+bool LibraryClient::reconnect() { return !path.empty() && connect(path); }
+
+void LibraryClient::close() {
+  if (fd >= 0) {
+    ::close(fd);
+    fd = -1;
+  }
+  out.clear();
+  in.clear();
+  inUsed = 0;
+}
+
+bool LibraryClient::call(uint8_t code, const vSV &fields, Message &reply) {
+  send(code, fields);
+  return receive(reply);
+}
+
+void LibraryClient::send(uint8_t code, const vSV &fields) {
+  encodeMessage(code, fields, out);
+}
+
+bool LibraryClient::flush() {
+  ul written(0);
+  while (written < out.size()) {
+    ssize_t n(
+        ::send(fd, out.data() + written, out.size() - written, sendFlags));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      close(); // the server has gone
+      return false;
+    }
+    written += n;
+  }
+  out.clear();
+  return true;
+}
+
+bool LibraryClient::receive(Message &reply) {
+  if (!isOpen() || (!out.empty() && !flush())) {
+    return false;
+  }
+  char buffer[64 * 1024];
+  for (;;) {
+    ul used;
+    if (!decodeMessage(std::string_view(in).substr(inUsed), reply, used)) {
+      close();
+      return false;
+    }
+    if (used > 0) {
+      inUsed += used;
+      return true;
+    }
+    in.erase(0, inUsed); // what was handed out is no longer needed
+    inUsed = 0;
+    ssize_t n(::read(fd, buffer, sizeof(buffer)));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      close();
+      return false;
+    }
+    in.append(buffer, n);
+  }
+}
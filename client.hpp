@@ -0,0 +1,42 @@
+// client.hpp
+#ifndef CLIENT_HPP
+#define CLIENT_HPP
+
+#include "protocol.hpp"
+#include "lms_project.hpp"
+
+/*
+ The client end of lms serve (see server.hpp and protocol.hpp). call()
+ sends one request and waits for its reply. For throughput, send() queues
+ requests without waiting and receive() collects their replies in the
+ order they were sent; receive() flushes what is queued first.
+ When the server hangs up or sends garbage the connection is closed, and
+ every call fails until reconnect() opens a new one to the same socket.
+ */
+class LibraryClient {
+public:
+  LibraryClient() = default;
+  LibraryClient(const LibraryClient &) = delete;
+  LibraryClient &operator=(const LibraryClient &) = delete;
+  ~LibraryClient() { close(); }
+
+  bool connect(const std::string &socketPath);
+  bool reconnect(); // to the socket last connected to
+  void close();
+  bool isOpen() const { return fd >= 0; }
+
+  // the reply's fields stay valid until the next call or receive
+  bool call(uint8_t code, const vSV &fields, Message &reply);
+  void send(uint8_t code, const vSV &fields);
+  bool flush();
+  bool receive(Message &reply);
+
+private:
+  int fd = -1;
+  std::string path; // of the socket
+  std::string out; // requests not yet written
+  std::string in;  // replies read, from inUsed on not yet handed out
+  ul inUsed = 0;
+};
+
+#endif // CLIENT_HPP
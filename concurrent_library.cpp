@@ -0,0 +1,58 @@
+// concurrent_library.cpp
+
+#include "concurrent_library.hpp"
+#include "library.hpp"
+#include "trace.hpp"
+#include "lms_project.hpp"
+
+ConcurrentLibrary::ConcurrentLibrary(Library &aLibrary)
+    : primary(aLibrary), sides{&aLibrary, &mirror} {
+  if (primary.readOnly()) {
+    sides[1] = &primary; // nothing to copy: the mapped file never changes
+  } else {
+    mirror.assign(primary);
+  }
+}
+
+// makes side the copy readers get, and waits until none is on the other
+void ConcurrentLibrary::publish(int side) {
+  published = side;
+  while (readers[1 - side].count.load() != 0) {
+    std::this_thread::yield();
+  }
+}
+
+void ConcurrentLibrary::apply(std::vector<BookEdit> &edits) {
+  TraceSpan span("ConcurrentLibrary::apply");
+  std::lock_guard<std::mutex> turn(writing);
+  if (primary.readOnly()) {
+    for (BookEdit &e : edits) {
+      e.done = false;
+    }
+    return;
+  }
+  // the primary goes first: what it journals decides what is done
+  publish(1);
+  for (BookEdit &e : edits) {
+    e.done = e.remove ? primary.removeBook(e.isbn)
+                      : primary.addBook(e.title, e.author, e.isbn);
+  }
+  publish(0);
+  for (const BookEdit &e : edits) {
+    if (e.done && e.remove) {
+      mirror.removeBook(e.isbn);
+    } else if (e.done) {
+      mirror.addBook(e.title, e.author, e.isbn);
+    }
+  }
+  mirror.compact(); // the mirror is never saved, which would do it
+}
+
+// readers stay on the mirror while the primary is saved, and maybe compacted
+void ConcurrentLibrary::checkpoint() {
+  std::lock_guard<std::mutex> turn(writing);
+  if (!primary.readOnly()) {
+    publish(1);
+  }
+  primary.checkpoint();
+}
@@ -0,0 +1,75 @@
+// concurrent_library.hpp
+#ifndef CONCURRENT_LIBRARY_HPP
+#define CONCURRENT_LIBRARY_HPP
+
+#include "library.hpp"
+#include "lms_project.hpp"
+
+// an addBook (title, author, isbn) or removeBook (isbn); done is the result
+struct BookEdit {
+  bool remove = false;
+  std::string title;
+  std::string author;
+  std::string isbn;
+  bool done = false;
+};
+
+/*
+ A Library that lookups on any number of threads read while one thread
+ edits it, the readers never waiting for the writer (left-right). There
+ are two copies of the catalog: the Library given, which keeps the journal
+ and the snapshot, and a mirror that is never saved. Readers use whichever
+ copy is published. apply edits the other one, publishes it, waits for the
+ readers still on the old one to finish and repeats the edits there, so
+ both copies always hold the same catalog once it returns. A batch of
+ edits is seen all at once or not at all.
+
+ read() costs two atomic increments, plus a retry in the rare case a copy
+ is published between them. An edit costs twice what Library's does (and
+ is counted twice in metrics.hpp), and the catalog takes twice the memory.
+ The writer waits for the lookups under way, so each should be short.
+
+ Edits and checkpoints come from one thread at a time; concurrent callers
+ wait their turn. A read-only Library is shared as it is (its edits are
+ refused anyway), but its caches fill on first use, so only one thread at
+ a time may read it.
+ */
+class ConcurrentLibrary {
+public:
+  explicit ConcurrentLibrary(Library &aLibrary);
+  ConcurrentLibrary(const ConcurrentLibrary &) = delete;
+  ConcurrentLibrary &operator=(const ConcurrentLibrary &) = delete;
+
+  // calls look(const Library &) on a copy no edit touches meanwhile; the
+  // books it finds are only valid until it returns
+  template <class Look> void read(Look look) const {
+    while (true) {
+      int side(published.load());
+      readers[side].count++;
+      if (published.load() == side) {
+        look(*sides[side]);
+        readers[side].count--;
+        return;
+      }
+      readers[side].count--; // an edit started: use the other copy
+    }
+  }
+  void apply(std::vector<BookEdit> &edits);
+  void checkpoint();
+
+private:
+  void publish(int side);
+
+  struct alignas(64) Readers { // apart, so the two counts do not share a line
+    std::atomic<ul> count{0};
+  };
+
+  Library &primary;
+  Library mirror;
+  Library *sides[2];
+  std::atomic<int> published{0};
+  mutable Readers readers[2];
+  std::mutex writing;
+};
+
+#endif // CONCURRENT_LIBRARY_HPP
@@ -0,0 +1,46 @@
+// field_widths.hpp
+#ifndef FIELD_WIDTHS_HPP
+#define FIELD_WIDTHS_HPP
+
+#include <cstddef>
+#include <vector>
+
+/*
+ Widest of a changing collection of field lengths. counts[w] is how many
+ fields are w bytes long, so removing the widest one only has to step down
+ to the next bucket that is not empty instead of measuring every field
+ again. add is O(1), remove O(1) amortised over the adds, widest O(1).
+ */
+class WidthHistogram {
+public:
+  void add(size_t width) {
+    if (width >= counts.size()) {
+      counts.resize(width + 1);
+    }
+    counts[width]++;
+    top = width > top ? width : top;
+  }
+
+  void remove(size_t width) {
+    if (width >= counts.size() || counts[width] == 0) {
+      return;
+    }
+    counts[width]--;
+    while (top > 0 && counts[top] == 0) {
+      top--;
+    }
+  }
+
+  size_t widest() const { return top; }
+
+  void clear() {
+    counts.clear();
+    top = 0;
+  }
+
+private:
+  std::vector<size_t> counts;
+  size_t top = 0; // widest width with a nonzero count, 0 when empty
+};
+
+#endif // FIELD_WIDTHS_HPP
@@ -0,0 +1,82 @@
+// fuzzy.cpp
+
+#include "fuzzy.hpp"
+#include "lms_project.hpp"
+
+FuzzyMatcher::FuzzyMatcher(std::string_view p) : pattern(p) {
+  std::fill(std::begin(peq), std::end(peq), 0);
+  for (ul i = 0; i < pattern.size() && i < 64; i++) {
+    peq[(unsigned char)pattern[i]] |= uint64_t(1) << i;
+  }
+}
+
+ul FuzzyMatcher::distance(std::string_view text, ul limit) const {
+  ul m(pattern.size()), n(text.size());
+  if ((m > n ? m - n : n - m) > limit) {
+    return limit + 1; // the length difference alone is too much
+  }
+  if (m == 0 || n == 0) {
+    return m + n;
+  }
+  if (m > 64) {
+    return slowDistance(text, limit);
+  }
+  /*
+   Myers/Hyyrö: Pv/Mv hold the +1/-1 vertical deltas of the current column,
+   score tracks its last cell. The top row grows by one each column, hence
+   the 1 shifted into Ph.
+   */
+  uint64_t pv(~uint64_t(0)), mv(0), high(uint64_t(1) << (m - 1));
+  ul score(m);
+  for (ul j = 0; j < n; j++) {
+    uint64_t eq(peq[(unsigned char)text[j]]);
+    uint64_t xv(eq | mv);
+    uint64_t xh((((eq & pv) + pv) ^ pv) | eq);
+    uint64_t ph(mv | ~(xh | pv));
+    uint64_t mh(pv & xh);
+    if (ph & high) {
+      score++;
+    } else if (mh & high) {
+      score--;
+    }
+    ph = (ph << 1) | 1;
+    mh <<= 1;
+    pv = mh | ~(xv | ph);
+    mv = ph & xv;
+    if (score > limit + (n - j - 1)) {
+      return limit + 1; // each remaining column lowers it by one at most
+    }
+  }
+  return score > limit ? limit + 1 : score;
+}
+
+ul typosAllowed(std::string_view name) {
+  return name.size() <= 4 ? 1 : name.size() <= 12 ? 2 : 3;
+}
+
+uint64_t byteSignature(std::string_view s) {
+  uint64_t signature(0);
+  for (unsigned char c : s) {
+    signature |= uint64_t(1) << (c % 64);
+  }
+  return signature;
+}
+
+ul FuzzyMatcher::slowDistance(std::string_view text, ul limit) const {
+  std::vector<ul> prev(text.size() + 1), cur(text.size() + 1);
+  std::iota(prev.begin(), prev.end(), 0);
+  for (ul i = 1; i <= pattern.size(); i++) {
+    cur[0] = i;
+    ul best(cur[0]);
+    for (ul j = 1; j <= text.size(); j++) {
+      ul replace(prev[j - 1] + (pattern[i - 1] != text[j - 1]));
+      cur[j] = std::min({replace, prev[j] + 1, cur[j - 1] + 1});
+      best = std::min(best, cur[j]);
+    }
+    if (best > limit) {
+      return limit + 1;
+    }
+    std::swap(prev, cur);
+  }
+  return std::min(prev[text.size()], limit + 1);
+}
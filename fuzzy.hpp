@@ -0,0 +1,39 @@
+// fuzzy.hpp
+#ifndef FUZZY_HPP
+#define FUZZY_HPP
+
+#include "lms_project.hpp"
+
+/*
+ Levenshtein distance from one pattern to many texts. Patterns of up to 64
+ bytes use Myers' bit-parallel algorithm: one machine word holds a whole
+ column of the edit matrix, so a text costs O(length) word operations.
+ Longer patterns fall back to the two-row dynamic program.
+
+ distance() gives up as soon as the result must exceed limit and then
+ returns limit + 1, so scanning a long list for near matches stays cheap.
+ Strings compare byte by byte; fold them first (see text.hpp) to ignore
+ case and spacing.
+ */
+class FuzzyMatcher {
+public:
+  explicit FuzzyMatcher(std::string_view pattern);
+  ul distance(std::string_view text, ul limit) const;
+
+private:
+  ul slowDistance(std::string_view text, ul limit) const;
+
+  std::string pattern;
+  uint64_t peq[256]; // bit i set when pattern[i] is the byte
+};
+
+// how many edits away a misspelt name may be and still be suggested; short
+// names allow fewer, or everything would match
+ul typosAllowed(std::string_view name);
+
+// bit b % 64 set for every byte b in s. One edit changes at most two bits,
+// so the distance between two strings is at least half the popcount of
+// their signatures' xor: a cheap test before distance()
+uint64_t byteSignature(std::string_view s);
+
+#endif // FUZZY_HPP
@@ -0,0 +1,52 @@
+// hash.hpp
+#ifndef HASH_HPP
+#define HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+/*
+ Hashing helpers. hashMix is the 64-bit finalizer from MurmurHash3: every
+ input bit affects every output bit. hashCombine folds one hash into another
+ order-dependently, so books whose fields are merely permuted do not collide.
+
+ umB keeps std::hash on its ISBN-13 keys: they are already well spread
+ integers, the tables use prime bucket counts, and mixing them measured
+ slower on lookup-heavy runs.
+ */
+inline uint64_t hashMix(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+// the seed is mixed on its own first, so combine(a, b) != combine(b, a)
+inline size_t hashCombine(size_t seed, size_t value) {
+  return hashMix(hashMix(seed) + 0x9e3779b97f4a7c15ULL + value);
+}
+
+/*
+ transparent string hash: with std::equal_to<> it lets a string-keyed map
+ (the word index's, see word_index.hpp) be probed with a string_view or
+ char buffer directly, without building a std::string key first.
+ */
+struct StringHash {
+  using is_transparent = void;
+  size_t operator()(std::string_view s) const {
+    return std::hash<std::string_view>()(s);
+  }
+  size_t operator()(const std::string &s) const {
+    return std::hash<std::string_view>()(s);
+  }
+  size_t operator()(const char *s) const {
+    return std::hash<std::string_view>()(s);
+  }
+};
+
+#endif // HASH_HPP
@@ -0,0 +1,70 @@
+// isbn.cpp
+
+#include "isbn.hpp"
+#include "lms_project.hpp"
+
+bool parseISBN(std::string_view text, uint64_t &key) {
+  int digits[13];
+  int n(0);
+  for (char ch : text) {
+    if (ch == '-' || ch == ' ') {
+      continue;
+    }
+    if (n == 13) {
+      return false;
+    }
+    if (ch >= '0' && ch <= '9') {
+      digits[n++] = ch - '0';
+    } else if ((ch == 'X' || ch == 'x') && n == 9) {
+      digits[n++] = 10; // only valid as an ISBN-10 check digit
+    } else {
+      return false;
+    }
+  }
+
+  if (n == 10) {
+    int sum(0);
+    for (int i = 0; i < 10; i++) {
+      sum += (10 - i) * digits[i];
+    }
+    if (sum % 11 != 0) {
+      return false;
+    }
+    // 978 + the first nine digits, with a fresh ISBN-13 check digit
+    int body[12] = {9, 7, 8};
+    std::copy(digits, digits + 9, body + 3);
+    std::copy(body, body + 12, digits);
+    sum = 0;
+    for (int i = 0; i < 12; i++) {
+      sum += digits[i] * (i & 1 ? 3 : 1);
+    }
+    digits[12] = (10 - sum % 10) % 10;
+  } else if (n == 13) {
+    int sum(0);
+    for (int i = 0; i < 13; i++) {
+      if (digits[i] > 9) {
+        return false;
+      }
+      sum += digits[i] * (i & 1 ? 3 : 1);
+    }
+    if (sum % 10 != 0) {
+      return false;
+    }
+  } else {
+    return false;
+  }
+
+  key = 0;
+  for (int i = 0; i < 13; i++) {
+    key = key * 10 + digits[i];
+  }
+  return true;
+}
+
+uint64_t catalogKey(std::string_view isbn) {
+  uint64_t key;
+  if (parseISBN(isbn, key)) {
+    return key;
+  }
+  return std::hash<std::string_view>()(isbn) | (uint64_t(1) << 63);
+}
@@ -0,0 +1,22 @@
+// isbn.hpp
+#ifndef ISBN_HPP
+#define ISBN_HPP
+
+#include "lms_project.hpp"
+
+/*
+ ISBN handling. Hyphens and spaces are ignored, the check digit is
+ verified, and an ISBN-10 is converted to its ISBN-13 (978 prefix), so every
+ spelling of the same book yields the same 13-digit number.
+ */
+bool parseISBN(std::string_view text, uint64_t &key);
+
+/*
+ the catalog key for an ISBN string: the parsed ISBN-13 when it is valid,
+ otherwise a hash of the text with the top bit set (valid ISBN-13 numbers
+ never reach it), so catalogs holding malformed ISBNs still load and can be
+ searched by their exact text.
+ */
+uint64_t catalogKey(std::string_view isbn);
+
+#endif // ISBN_HPP
@@ -0,0 +1,181 @@
+// journal.cpp
+
+#include "journal.hpp"
+#include "text.hpp"
+#include "trace.hpp"
+#include "lms_project.hpp"
+
+namespace {
+
+const ul recordHeaderSize = 9; // crc, length, op
+
+uint32_t crc32(const char *data, ul size, uint32_t crc = 0) {
+  static uint32_t table[256] = {0};
+  if (table[1] == 0) {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c(i);
+      for (int k = 0; k < 8; k++) {
+        c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      }
+      table[i] = c;
+    }
+  }
+  crc = ~crc;
+  for (ul i = 0; i < size; i++) {
+    crc = table[(crc ^ uint8_t(data[i])) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+void putU32(std::string &out, uint32_t v) {
+  out.append(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+uint32_t getU32(const char *p) {
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+// reads one length-prefixed field at p, advancing p; false if it overruns end
+bool getField(const char *&p, const char *end, std::string &out) {
+  if (end - p < 4) {
+    return false;
+  }
+  uint32_t n(getU32(p));
+  p += 4;
+  if (ul(end - p) < n) {
+    return false;
+  }
+  out.assign(p, n);
+  p += n;
+  return true;
+}
+
+} // namespace
+
+Journal::~Journal() { close(); }
+
+/*
+ opens path for appending. Anything past the last valid record (a torn write
+ from a crash) is cut off first, so new records follow good ones.
+ */
+bool Journal::open(const std::string &path) {
+  close();
+  ul valid(replay(path, [](JournalOp, Book &) {}));
+  fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  if (ftruncate(fd, valid) != 0) {
+    close();
+    return false;
+  }
+  length = valid;
+  unsynced = 0;
+  torn = false;
+  return true;
+}
+
+void Journal::close() {
+  if (fd >= 0) {
+    sync();
+    ::close(fd);
+    fd = -1;
+  }
+}
+
+bool Journal::append(JournalOp op, const Book &aBook) {
+  if (fd < 0 || (torn && ftruncate(fd, length) != 0)) {
+    return false;
+  }
+  torn = false;
+  std::string record(recordHeaderSize, '\0');
+  record[8] = char(op);
+  for (std::string_view s : {aBook.getTitleView(), aBook.getAuthorView(),
+                             aBook.getISBNView()}) {
+    putU32(record, s.size());
+    record.append(s);
+  }
+  uint32_t len(record.size() - recordHeaderSize);
+  std::memcpy(&record[4], &len, sizeof(len));
+  uint32_t crc(crc32(record.data() + 4, record.size() - 4));
+  std::memcpy(&record[0], &crc, sizeof(crc));
+
+  ssize_t written(write(fd, record.data(), record.size()));
+  if (written != ssize_t(record.size())) {
+    // replay stops at a torn record, so one left in place would hide every
+    // record appended after it: cut it off, or before the next append
+    torn = written > 0 && ftruncate(fd, length) != 0;
+    return false;
+  }
+  ++unsynced;
+  if (syncEvery && unsynced >= syncEvery && !sync()) {
+    // not known to be on disk, and the caller will not apply the edit
+    torn = ftruncate(fd, length) != 0;
+    return false;
+  }
+  length += record.size();
+  return true;
+}
+
+bool Journal::sync() {
+  if (fd < 0 || unsynced == 0) {
+    return true;
+  }
+  unsynced = 0;
+  return fsync(fd) == 0;
+}
+
+// empties the journal once its records are folded into a new snapshot
+bool Journal::reset() {
+  if (fd < 0) {
+    return false;
+  }
+  if (ftruncate(fd, 0) != 0) {
+    return false;
+  }
+  length = 0;
+  unsynced = 0;
+  return fsync(fd) == 0;
+}
+
+/*
+ calls apply for each valid record in path, in order, and returns the byte
+ length of the valid prefix. Replay stops at the first record that is short
+ or fails its checksum. The Book handed to apply views this call's buffers
+ and is gone when apply returns; nothing is interned.
+ */
+ul Journal::replay(const std::string &path,
+                   const std::function<void(JournalOp, Book &)> &apply) {
+  TraceSpan span("Journal::replay");
+  std::ifstream ifs(path, std::ios::binary);
+  if (!ifs.is_open()) {
+    return 0;
+  }
+  std::string data((std::istreambuf_iterator<char>(ifs)),
+                   std::istreambuf_iterator<char>());
+  ul pos(0);
+  std::string title, author, isbn, titleKey, authorKey;
+  while (data.size() - pos >= recordHeaderSize) {
+    const char *rec(data.data() + pos);
+    uint32_t len(getU32(rec + 4));
+    if (data.size() - pos - recordHeaderSize < len ||
+        getU32(rec) != crc32(rec + 4, len + recordHeaderSize - 4)) {
+      break;
+    }
+    JournalOp op = JournalOp(rec[8]);
+    const char *p(rec + recordHeaderSize), *end(p + len);
+    if ((op != journalAdd && op != journalRemove) ||
+        !getField(p, end, title) || !getField(p, end, author) ||
+        !getField(p, end, isbn)) {
+      break;
+    }
+    foldTextInto(title, titleKey);
+    foldTextInto(author, authorKey);
+    Book aBook(Book::fromViews(title, author, isbn, titleKey, authorKey));
+    apply(op, aBook);
+    pos += recordHeaderSize + len;
+  }
+  return pos;
+}
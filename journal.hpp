@@ -0,0 +1,52 @@
+// journal.hpp
+#ifndef JOURNAL_HPP
+#define JOURNAL_HPP
+
+#include "book.hpp"
+#include "lms_project.hpp"
+
+/*
+ Append-only log of catalog edits kept next to the binary snapshot. Each
+ record is
+
+   uint32_t crc      CRC-32 of everything after this field
+   uint32_t length   bytes of payload
+   uint8_t  op       JournalOp
+   payload           title, author, isbn, each as uint32_t size + bytes
+
+ and is written with a single write(2), so a crash leaves at most one torn
+ record at the tail, which replay detects and discards. append returns
+ false when the record did not reach the file whole (or, syncing, the
+ disk); the caller must then not apply the edit. What was written of it
+ is cut off again, so later records still replay.
+ */
+enum JournalOp : uint8_t { journalAdd = 1, journalRemove = 2 };
+
+class Journal {
+public:
+  Journal() = default;
+  Journal(const Journal &) = delete;
+  Journal &operator=(const Journal &) = delete;
+  ~Journal();
+  bool open(const std::string &path);
+  void close();
+  bool isOpen() const { return fd >= 0; }
+  bool append(JournalOp op, const Book &aBook);
+  bool sync();
+  bool reset();
+  ul bytes() const { return length; }
+  // fsync after every n appends; 0 leaves syncing to sync()/close()
+  void setSyncEvery(ul n) { syncEvery = n; }
+
+  static ul replay(const std::string &path,
+                   const std::function<void(JournalOp, Book &)> &apply);
+
+private:
+  int fd = -1;
+  ul length = 0;
+  ul unsynced = 0;
+  ul syncEvery = 1;
+  bool torn = false; // a failed record is still to be cut off at length
+};
+
+#endif // JOURNAL_HPP
@@ -1,19 +1,126 @@
 // library.cpp
 
 #include "library.hpp"
+#include "catalog_file.hpp"
+#include "client.hpp"
+#include "fuzzy.hpp"
+#include "isbn.hpp"
+#include "metrics.hpp"
+#include "protocol.hpp"
+#include "text.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
+#include "word_index.hpp"
 #include "lms_project.hpp"
 
-bool Library::empty() { return this->books.empty(); }
+namespace {
 
-ul Library::size() { return this->books.size(); }
+// keeps the keys of a that are also in b; a should be the shorter list
+void intersectSorted(vKey &a, const vKey &b) {
+  auto out(a.begin());
+  auto from(b.begin());
+  for (uint64_t key : a) {
+    from = std::lower_bound(from, b.end(), key);
+    if (from == b.end()) {
+      break;
+    }
+    if (*from == key) {
+      *out++ = key;
+    }
+  }
+  a.erase(out, a.end());
+}
+
+// the text a book alone is likely to hold in the pool; authors are shared
+ul ownBytes(const Book &aBook) {
+  ul n(aBook.getTitleView().size() + aBook.getISBNView().size());
+  if (aBook.getTitleKey().data() != aBook.getTitleView().data()) {
+    n += aBook.getTitleKey().size();
+  }
+  return n;
+}
 
-void Library::addBook(Book &aBook) { books[aBook.getISBN()] = aBook; }
+} // namespace
+
+bool Library::empty() const { return size() == 0; }
+
+ul Library::size() const {
+  if (remote()) {
+    Message reply;
+    ul n;
+    return ask(reqSize, {}, reply) && reply.fields.size() == 1 &&
+                   fieldNumber(reply.fields[0], n)
+               ? n
+               : 0;
+  }
+  return readOnly() ? mapped.size() : books.size();
+}
+
+bool Library::addBook(Book &aBook) {
+  return addBook(aBook.getTitleView(), aBook.getAuthorView(),
+                 aBook.getISBNView());
+}
+
+// refuses books whose ISBN is not a valid ISBN-10 or ISBN-13, and edits
+// the journal could not record, which would be lost on restart
+bool Library::addBook(std::string_view title, std::string_view author,
+                      std::string_view isbn) {
+  MetricTimer timer(metricAdd);
+  if (remote()) {
+    Message reply;
+    return ask(reqAdd, {title, author, isbn}, reply);
+  }
+  uint64_t key;
+  if (readOnly() || !parseISBN(isbn, key)) {
+    return false;
+  }
+  Book aBook(title, author, isbn, strings);
+  if (journal.isOpen() && !journal.append(journalAdd, aBook)) {
+    return false;
+  }
+  insertBook(aBook, key);
+  return true;
+}
 
 bool Library::removeBook(Book &aBook) {
-  auto it =
-      books.find(aBook.getISBN()); // Find the element in the unordered_map
+  return removeBook(aBook.getISBNView());
+}
+
+bool Library::removeBook(std::string_view isbn) {
+  MetricTimer timer(metricRemove);
+  if (remote()) {
+    Message reply;
+    return ask(reqRemove, {isbn}, reply);
+  }
+  uint64_t key(catalogKey(isbn));
+  auto it = books.find(key);
+  if (readOnly() || it == books.end()) {
+    return false; // nothing to journal
+  }
+  if (journal.isOpen() && !journal.append(journalRemove, it->second)) {
+    return false;
+  }
+  return eraseBook(key);
+}
+
+// stores a copy of aBook whose text lives in the Library's own pool
+void Library::insertBook(const Book &aBook, uint64_t key) {
+  auto it = books.find(key);
+  if (it != books.end()) {
+    unindexBook(it->second, key); // the old copy is about to be replaced
+    reclaimable += ownBytes(it->second);
+  }
+  Book &stored(books[key]);
+  stored = aBook.pooledIn(strings);
+  indexBook(stored, key);
+}
+
+bool Library::eraseBook(uint64_t key) {
+  auto it = books.find(key); // Find the element in the unordered_map
 
   if (it != books.end()) {
+    unindexBook(it->second, key);
+    reclaimable += ownBytes(it->second);
     books.erase(it); // Erase the element using the iterator
     return true;     // Return true indicating successful erasure
   }
@@ -22,50 +129,1012 @@ bool Library::removeBook(Book &aBook) {
 
 void Library::displayAllBooks() {
   for (const auto &aPair : books) {
-    Book tmp;
-    tmp = aPair.second;
-    std::cout << tmp.formatBook();
+    std::cout << aPair.second.formatBook();
+  }
+}
+
+void Library::catalog(vpBook &results) const {
+  if (remote()) {
+    scan([](const Book &) { return true; }, results);
+    return;
+  }
+  results.clear();
+  if (readOnly()) {
+    trimMaterialized();
+    results.reserve(mapped.size());
+    for (ul i = 0; i < mapped.size(); i++) {
+      results.emplace_back(materialize(i));
+    }
+    return;
+  }
+  results.reserve(books.size());
+  for (const auto &aPair : books) {
+    results.emplace_back(&aPair.second);
+  }
+}
+
+// the books ranked first .. first + count - 1 in order; fewer near the end
+void Library::catalogPage(CatalogOrder order, ul first, ul count,
+                          vpBook &page) const {
+  MetricTimer timer(metricPage);
+  if (remote()) {
+    std::string o(std::to_string(order)), f(std::to_string(first)),
+        n(std::to_string(count));
+    askBooks(reqPage, {o, f, n}, page);
+    return;
+  }
+  page.clear();
+  if (readOnly()) {
+    trimMaterialized();
+    for (ul i = first; i < mapped.size() && page.size() < count; i++) {
+      ul record(mapped.ordered(order, i));
+      if (record < mapped.size()) {
+        page.emplace_back(materialize(record));
+      }
+    }
+    return;
+  }
+  auto add = [&](uint64_t key) {
+    auto found = books.find(key);
+    if (found != books.end()) {
+      page.emplace_back(&found->second);
+    }
+  };
+  if (order == orderISBN) {
+    for (auto it = isbnOrder.at(first);
+         it != isbnOrder.end() && page.size() < count; ++it) {
+      add(*it);
+    }
+    return;
+  }
+  const sbSK &sorted(order == orderTitle ? titleOrder : authorOrder);
+  for (auto it = sorted.at(first); it != sorted.end() && page.size() < count;
+       ++it) {
+    add(it->second);
+  }
+}
+
+// the lengths of the longest title, author and ISBN in the catalog
+void Library::fieldWidths(ul &title, ul &author, ul &isbn) const {
+  if (remote()) {
+    Message reply;
+    title = author = isbn = 0;
+    if (ask(reqWidths, {}, reply) && reply.fields.size() == 3) {
+      fieldNumber(reply.fields[0], title);
+      fieldNumber(reply.fields[1], author);
+      fieldNumber(reply.fields[2], isbn);
+    }
+    return;
+  }
+  if (readOnly() && !mappedWidthsMeasured) {
+    for (ul i = 0; i < mapped.size(); i++) {
+      titleWidths.add(mapped.title(i).size());
+      authorWidths.add(mapped.author(i).size());
+      isbnWidths.add(mapped.isbn(i).size());
+    }
+    mappedWidthsMeasured = true;
+  }
+  title = titleWidths.widest();
+  author = authorWidths.widest();
+  isbn = isbnWidths.widest();
+}
+
+void Library::searchByAuthor(std::string_view author, vpBook &results) const {
+  MetricTimer timer(metricSearchAuthor);
+  if (remote()) {
+    askBooks(reqAuthor, {author}, results);
+    return;
+  }
+  if (readOnly()) {
+    searchMapped(orderAuthor, author, results);
+    return;
+  }
+  searchOrder(authorOrder, author, results);
+}
+
+void Library::searchByISBN(std::string_view isbn, vpBook &results) const {
+  MetricTimer timer(metricSearchISBN);
+  if (remote()) {
+    askBooks(reqISBN, {isbn}, results);
+    return;
+  }
+  if (readOnly()) {
+    searchMapped(orderISBN, isbn, results);
+    return;
+  }
+  results.clear();
+  auto it = books.find(catalogKey(isbn));
+  if (it != books.end()) {
+    results.emplace_back(&it->second);
+  }
+}
+
+void Library::searchByTitle(std::string_view title, vpBook &results) const {
+  MetricTimer timer(metricSearchTitle);
+  if (remote()) {
+    askBooks(reqTitle, {title}, results);
+    return;
+  }
+  if (readOnly()) {
+    searchMapped(orderTitle, title, results);
+    return;
+  }
+  searchOrder(titleOrder, title, results);
+}
+
+// binary search of the mapped catalog's sorted order; builds only the hits
+void Library::searchMapped(CatalogOrder order, std::string_view key,
+                           vpBook &results) const {
+  results.clear();
+  trimMaterialized();
+  ul first, last;
+  mapped.equalRange(order, key, first, last);
+  for (ul i = first; i < last; i++) {
+    ul record(mapped.ordered(order, i));
+    if (record < mapped.size()) {
+      results.emplace_back(materialize(record));
+    }
+  }
+}
+
+/*
+ the Book for a mapped record, built on first use and kept for reuse. Its
+ fields are views into the mapping; its folded keys live in the cache
+ entry, so nothing is interned and the entry is all it costs.
+ */
+const Book *Library::materialize(ul record) const {
+  auto [it, added] = materialized.try_emplace(record);
+  MappedBook &m(it->second);
+  if (added) {
+    m.titleKey = foldText(mapped.title(record));
+    m.authorKey = foldText(mapped.author(record));
+    m.book = Book::fromViews(mapped.title(record), mapped.author(record),
+                             mapped.isbn(record), m.titleKey, m.authorKey);
+  }
+  return &m.book;
+}
+
+/*
+ called as a call that returns mapped books starts: once the cache holds
+ more than materializedLimit Books it is emptied, so memory follows the
+ books in use rather than every book ever shown. Books handed out by
+ earlier calls are gone then; those of the call under way are not.
+ */
+void Library::trimMaterialized() const {
+  if (materialized.size() > materializedLimit) {
+    materialized.clear();
+  }
+}
+
+/*
+ collects every book whose field folds to the same text as key. The order
+ maps the folded field to an ISBN, which is then resolved through books.
+ */
+void Library::searchOrder(const sbSK &order, std::string_view key,
+                          vpBook &results) const {
+  results.clear();
+  std::string folded(foldText(key));
+  auto first(order.lowerBound(std::make_pair(std::string_view(folded), 0)));
+  for (auto it = first; it != order.end() && it->first == folded; ++it) {
+    auto found = books.find(it->second);
+    if (found != books.end()) {
+      results.emplace_back(&found->second);
+    }
+  }
+}
+
+void Library::indexBook(const Book &aBook, uint64_t key) {
+  candidatesStale = true;
+  if (!indexed) {
+    return;
+  }
+  titleOrder.insert(std::make_pair(aBook.getTitleKey(), key));
+  authorOrder.insert(std::make_pair(aBook.getAuthorKey(), key));
+  isbnOrder.insert(key);
+  titleWidths.add(aBook.getTitleView().size());
+  authorWidths.add(aBook.getAuthorView().size());
+  isbnWidths.add(aBook.getISBNView().size());
+  titleWords.add(aBook.getTitleView(), key);
+  authorWords.add(aBook.getAuthorView(), key);
+}
+
+void Library::unindexBook(const Book &aBook, uint64_t key) {
+  candidatesStale = true;
+  if (!indexed) {
+    return;
+  }
+  titleOrder.erase(std::make_pair(aBook.getTitleKey(), key));
+  authorOrder.erase(std::make_pair(aBook.getAuthorKey(), key));
+  isbnOrder.erase(key);
+  titleWidths.remove(aBook.getTitleView().size());
+  authorWidths.remove(aBook.getAuthorView().size());
+  isbnWidths.remove(aBook.getISBNView().size());
+  titleWords.remove(aBook.getTitleView(), key);
+  authorWords.remove(aBook.getAuthorView(), key);
+}
+
+void Library::rebuildIndexes() {
+  TraceSpan span("Library::rebuildIndexes");
+  candidatesStale = true;
+  vSK titles, authors;
+  vKey keys;
+  titles.reserve(books.size());
+  authors.reserve(books.size());
+  keys.reserve(books.size());
+  titleWidths.clear();
+  authorWidths.clear();
+  isbnWidths.clear();
+  for (const auto &aPair : books) {
+    titles.emplace_back(aPair.second.getTitleKey(), aPair.first);
+    authors.emplace_back(aPair.second.getAuthorKey(), aPair.first);
+    keys.push_back(aPair.first);
+    titleWidths.add(aPair.second.getTitleView().size());
+    authorWidths.add(aPair.second.getAuthorView().size());
+    isbnWidths.add(aPair.second.getISBNView().size());
+  }
+  std::sort(titles.begin(), titles.end());
+  std::sort(authors.begin(), authors.end());
+  std::sort(keys.begin(), keys.end());
+  titleOrder.assign(titles);
+  authorOrder.assign(authors);
+  isbnOrder.assign(keys);
+
+  // in ascending key order every posting is a plain append
+  titleWords.clear();
+  authorWords.clear();
+  for (uint64_t key : keys) {
+    const Book &aBook(books.find(key)->second);
+    titleWords.add(aBook.getTitleView(), key);
+    authorWords.add(aBook.getAuthorView(), key);
   }
+  indexed = true;
 }
 
-void Library::searchByAuthor(std::string &author, std::vector<Book> &results) {
+/*
+ books whose title or author contains every word of query, best match
+ first. Each word scores log(1 + n / books with it), so rare words count
+ for more, doubled when it is in the title. Ties go to the shorter title,
+ then to ISBN order. The rarest word's list is intersected first.
+ */
+void Library::searchByWords(std::string_view query, vpBook &results) const {
+  MetricTimer timer(metricSearchWords);
+  if (remote()) {
+    askBooks(reqWords, {query}, results);
+    return;
+  }
   results.clear();
-  for (auto aPair : books) {
-    if (aPair.second.getAuthor() == author) {
-      results.emplace_back(aPair.second);
+  vString words;
+  splitWords(query, words);
+  std::sort(words.begin(), words.end());
+  words.erase(std::unique(words.begin(), words.end()), words.end());
+  if (words.empty()) {
+    return;
+  }
+  if (readOnly() && !mappedWordsIndexed) {
+    indexMappedWords();
+  }
+  trimMaterialized();
+  std::vector<vKey> inTitle(words.size()), hits(words.size());
+  vKey inAuthor;
+  for (ul i = 0; i < words.size(); i++) {
+    titleWords.postings(words[i], inTitle[i]);
+    authorWords.postings(words[i], inAuthor);
+    std::set_union(inTitle[i].begin(), inTitle[i].end(), inAuthor.begin(),
+                   inAuthor.end(), std::back_inserter(hits[i]));
+    if (hits[i].empty()) {
+      return;
+    }
+  }
+  std::vector<ul> rarest(words.size());
+  std::iota(rarest.begin(), rarest.end(), 0);
+  std::sort(rarest.begin(), rarest.end(), [&hits](ul a, ul b) {
+    return hits[a].size() < hits[b].size();
+  });
+  vKey matched(hits[rarest[0]]);
+  for (ul i = 1; i < rarest.size() && !matched.empty(); i++) {
+    intersectSorted(matched, hits[rarest[i]]);
+  }
+
+  struct Ranked {
+    double score;
+    ul length; // words in the title
+    uint64_t key; // ISBN-13, in read-only mode too
+    const Book *book;
+  };
+  std::vector<Ranked> ranked;
+  ranked.reserve(matched.size());
+  double n(readOnly() ? mapped.size() : books.size());
+  vString titleWordList;
+  for (uint64_t key : matched) {
+    const Book *aBook(nullptr);
+    if (readOnly()) {
+      aBook = materialize(key);
+    } else {
+      auto found = books.find(key);
+      if (found == books.end()) {
+        continue;
+      }
+      aBook = &found->second;
+    }
+    double score(0);
+    for (ul i = 0; i < words.size(); i++) {
+      double weight(std::log(1 + n / hits[i].size()));
+      bool title(
+          std::binary_search(inTitle[i].begin(), inTitle[i].end(), key));
+      score += title ? 2 * weight : weight;
+    }
+    splitWords(aBook->getTitleView(), titleWordList);
+    uint64_t isbnKey(readOnly() ? catalogKey(aBook->getISBNView()) : key);
+    ranked.push_back({score, titleWordList.size(), isbnKey, aBook});
+  }
+  std::sort(ranked.begin(), ranked.end(),
+            [](const Ranked &a, const Ranked &b) {
+              if (a.score != b.score) {
+                return a.score > b.score;
+              }
+              if (a.length != b.length) {
+                return a.length < b.length;
+              }
+              return a.key < b.key;
+            });
+  results.reserve(ranked.size());
+  for (const Ranked &r : ranked) {
+    results.emplace_back(r.book);
+  }
+}
+
+/*
+ the k distinct authors, as entered, whose folded name is within
+ maxDistance edits of author's, closest first and then alphabetically.
+ Only candidates whose length is within maxDistance are looked at, most
+ of those are dismissed on their byte signatures, and most of the rest
+ after a few columns of the edit matrix.
+ */
+void Library::fuzzyAuthors(std::string_view author, ul maxDistance, ul k,
+                           vSV &authors) const {
+  MetricTimer timer(metricFuzzyAuthors);
+  if (remote()) {
+    std::string d(std::to_string(maxDistance)), n(std::to_string(k));
+    askNames(reqSimilar, {author, d, n}, authors);
+    return;
+  }
+  authors.clear();
+  std::string folded(foldText(author));
+  FuzzyMatcher matcher(folded);
+  uint64_t signature(byteSignature(folded));
+  struct Near {
+    ul distance;
+    std::string_view folded;
+    uint64_t key;
+  };
+  std::vector<Near> near;
+  const std::vector<AuthorCandidate> &all(authorCandidates());
+  ul shortest(folded.size() > maxDistance ? folded.size() - maxDistance : 0);
+  auto it = std::partition_point(
+      all.begin(), all.end(),
+      [&](const AuthorCandidate &c) { return c.folded.size() < shortest; });
+  for (; it != all.end() && it->folded.size() <= folded.size() + maxDistance;
+       ++it) {
+    if ((ul)std::popcount(it->signature ^ signature) > 2 * maxDistance) {
+      continue;
+    }
+    ul d(matcher.distance(it->folded, maxDistance));
+    if (d <= maxDistance) {
+      near.push_back({d, it->folded, it->key});
+    }
+  }
+  std::sort(near.begin(), near.end(), [](const Near &a, const Near &b) {
+    return a.distance != b.distance ? a.distance < b.distance
+                                    : a.folded < b.folded;
+  });
+  for (const Near &n : near) {
+    if (authors.size() == k) {
+      break;
+    }
+    if (readOnly()) {
+      authors.emplace_back(mapped.author(n.key));
+      continue;
+    }
+    auto found = books.find(n.key);
+    if (found != books.end()) {
+      authors.emplace_back(found->second.getAuthorView());
+    }
+  }
+}
+
+// distinctAuthors() with one entry per author, ordered by folded length
+const std::vector<Library::AuthorCandidate> &
+Library::authorCandidates() const {
+  std::lock_guard<std::mutex> lock(candidatesLock);
+  if (!candidatesStale) {
+    return candidates;
+  }
+  candidates.clear();
+  const sbSK &order(distinctAuthors());
+  for (auto it = order.begin(); it != order.end();) {
+    const auto entry(*it);
+    candidates.push_back(
+        {entry.first, entry.second, byteSignature(entry.first)});
+    if (++it != order.end() && it->first == entry.first) {
+      // skip the author's other books
+      it = order.upperBound(std::make_pair(entry.first, UINT64_MAX));
     }
   }
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [](const AuthorCandidate &a, const AuthorCandidate &b) {
+                     return a.folded.size() < b.folded.size();
+                   });
+  candidatesStale = false;
+  return candidates;
 }
 
-void Library::searchByISBN(std::string &isbn, std::vector<Book> &results) {
+// authorOrder, or in read-only mode its equivalent built from the file
+const sbSK &Library::distinctAuthors() const {
+  if (!readOnly()) {
+    return authorOrder;
+  }
+  if (mappedAuthors.empty() && mapped.size() > 0) {
+    vSK authors;
+    authors.reserve(mapped.size());
+    for (ul i = 0; i < mapped.size(); i++) {
+      authors.emplace_back(strings.intern(foldText(mapped.author(i))), i);
+    }
+    std::sort(authors.begin(), authors.end());
+    mappedAuthors.assign(authors);
+  }
+  return mappedAuthors;
+}
+
+/*
+ tests every book against match, in parallel. Each task takes a slice of
+ the hash table's buckets (or of the file's records in read-only mode) and
+ keeps its own hits, so the workers share nothing but the pool's counter.
+ The hits are put in ISBN order at the end, so the result does not depend
+ on how the work was split.
+ */
+void Library::scan(const BookPredicate &match, vpBook &results) const {
+  MetricTimer timer(metricScan);
   results.clear();
-  for (auto aPair : books) {
-    if (aPair.second.getISBN() == isbn) {
-      results.emplace_back(aPair.second);
+  if (remote()) { // the server cannot run our predicate: fetch everything
+    const ul pageSize(4096);
+    vpBook page;
+    for (ul first = 0;; first += pageSize) {
+      catalogPage(orderISBN, first, pageSize, page);
+      for (const Book *b : page) {
+        if (match(*b)) {
+          results.emplace_back(b);
+        }
+      }
+      if (page.size() < pageSize) {
+        return;
+      }
     }
   }
+  trimMaterialized();
+  ThreadPool &pool(workerPool());
+  ul tasks(pool.size() * 8);
+  std::vector<std::vector<std::pair<uint64_t, ul>>> hits(tasks);
+  if (readOnly()) {
+    ul n(mapped.size());
+    pool.run(tasks, [&](ul t) {
+      for (ul r = n * t / tasks; r < n * (t + 1) / tasks; r++) {
+        // workers must not intern, so the keys are folded privately
+        std::string titleKey(foldText(mapped.title(r)));
+        std::string authorKey(foldText(mapped.author(r)));
+        if (match(Book::fromViews(mapped.title(r), mapped.author(r),
+                                  mapped.isbn(r), titleKey, authorKey))) {
+          hits[t].emplace_back(catalogKey(mapped.isbn(r)), r);
+        }
+      }
+    });
+  } else {
+    ul n(books.bucket_count());
+    pool.run(tasks, [&](ul t) {
+      for (ul b = n * t / tasks; b < n * (t + 1) / tasks; b++) {
+        for (auto it = books.begin(b); it != books.end(b); ++it) {
+          if (match(it->second)) {
+            hits[t].emplace_back(it->first, 0);
+          }
+        }
+      }
+    });
+  }
+  std::vector<std::pair<uint64_t, ul>> merged;
+  for (const auto &part : hits) {
+    merged.insert(merged.end(), part.begin(), part.end());
+  }
+  std::sort(merged.begin(), merged.end());
+  results.reserve(merged.size());
+  for (const auto &hit : merged) {
+    results.emplace_back(readOnly() ? materialize(hit.second)
+                                    : &books.find(hit.first)->second);
+  }
+}
+
+// read-only mode: the word indexes, keyed by record number
+void Library::indexMappedWords() const {
+  titleWords.clear();
+  authorWords.clear();
+  for (ul i = 0; i < mapped.size(); i++) {
+    titleWords.add(mapped.title(i), i);
+    authorWords.add(mapped.author(i), i);
+  }
+  mappedWordsIndexed = true;
+}
+
+void Library::searchByTitlePrefix(std::string_view prefix, ul k,
+                                  vpBook &results) const {
+  MetricTimer timer(metricSearchTitlePrefix);
+  searchPrefix(titleOrder, orderTitle, prefix, k, results);
+}
+
+void Library::searchByAuthorPrefix(std::string_view prefix, ul k,
+                                   vpBook &results) const {
+  MetricTimer timer(metricSearchAuthorPrefix);
+  searchPrefix(authorOrder, orderAuthor, prefix, k, results);
+}
+
+void Library::completeTitle(std::string_view prefix, ul k,
+                            vSV &titles) const {
+  MetricTimer timer(metricComplete);
+  completePrefix(titleOrder, orderTitle, prefix, k, titles);
+}
+
+void Library::completeAuthor(std::string_view prefix, ul k,
+                             vSV &authors) const {
+  MetricTimer timer(metricComplete);
+  completePrefix(authorOrder, orderAuthor, prefix, k, authors);
 }
 
-void Library::searchByTitle(std::string &title, std::vector<Book> &results) {
+// the first k books, in order, whose folded field starts with prefix
+void Library::searchPrefix(const sbSK &order, CatalogOrder field,
+                           std::string_view prefix, ul k,
+                           vpBook &results) const {
+  if (remote()) {
+    std::string n(std::to_string(k));
+    askBooks(field == orderTitle ? reqTitlePrefix : reqAuthorPrefix,
+             {prefix, n}, results);
+    return;
+  }
   results.clear();
-  for (auto aPair : books) {
-    if (aPair.second.getTitle() == title) {
-      results.emplace_back(aPair.second);
-      // break;
+  if (readOnly()) {
+    trimMaterialized();
+    ul first, last;
+    mapped.prefixRange(field, prefix, first, last);
+    for (ul i = first; i < last && results.size() < k; i++) {
+      ul record(mapped.ordered(field, i));
+      if (record < mapped.size()) {
+        results.emplace_back(materialize(record));
+      }
+    }
+    return;
+  }
+  std::string folded(foldText(prefix));
+  auto it(order.lowerBound(std::make_pair(std::string_view(folded), 0)));
+  for (; it != order.end() && results.size() < k &&
+         it->first.starts_with(folded);
+       ++it) {
+    auto found = books.find(it->second);
+    if (found != books.end()) {
+      results.emplace_back(&found->second);
+    }
+  }
+}
+
+/*
+ the first k distinct titles or authors starting with prefix, as they were
+ entered. Each step skips every other book sharing the value, so the cost
+ is O(k log n) however many books a popular author has.
+ */
+void Library::completePrefix(const sbSK &order, CatalogOrder field,
+                             std::string_view prefix, ul k,
+                             vSV &values) const {
+  if (remote()) {
+    std::string n(std::to_string(k));
+    askNames(field == orderTitle ? reqCompleteTitle : reqCompleteAuthor,
+             {prefix, n}, values);
+    return;
+  }
+  values.clear();
+  if (readOnly()) { // walk the file's order, skipping repeats
+    ul first, last;
+    mapped.prefixRange(field, prefix, first, last);
+    std::string previous;
+    for (ul i = first; i < last && values.size() < k; i++) {
+      ul record(mapped.ordered(field, i));
+      if (record >= mapped.size()) {
+        continue;
+      }
+      std::string_view v(mapped.key(field, record));
+      std::string folded(foldText(v));
+      if (values.empty() || folded != previous) {
+        values.emplace_back(v);
+        previous = std::move(folded);
+      }
     }
+    return;
+  }
+  std::string folded(foldText(prefix));
+  auto it(order.lowerBound(std::make_pair(std::string_view(folded), 0)));
+  while (it != order.end() && values.size() < k &&
+         it->first.starts_with(folded)) {
+    auto found = books.find(it->second);
+    if (found != books.end()) {
+      values.emplace_back(field == orderTitle
+                              ? found->second.getTitleView()
+                              : found->second.getAuthorView());
+    }
+    it = order.upperBound(std::make_pair(it->first, UINT64_MAX));
   }
 }
 
+/*
+ the catalog is kept in the binary format (see catalog_file.hpp) plus the
+ journal. The boost text archive remains available through
+ exportText/importText, and is read once to migrate when no binary catalog
+ exists yet.
+ */
 void Library::serialize() {
-  std::ofstream ofs("library_data.txt");
-  boost::archive::text_oarchive oa(ofs);
-  oa << *this;
+  MetricTimer timer(metricSerialize);
+  if (readOnly() || remote()) {
+    return;
+  }
+  // writeCatalog returns once the snapshot is on disk, so the journal's
+  // records are no longer needed; on failure they stay to be replayed
+  if (writeCatalog(catalogPath, books)) {
+    journal.reset();
+    snapshotStale = false;
+  }
+  compact();
+}
+
+// compacts the catalog's text once removed books left enough of it behind
+void Library::compact() {
+  if (reclaimable > compactMinimum && reclaimable > strings.arenaBytes() / 2) {
+    compactStrings();
+  }
+}
+
+/*
+ moves every book's text into a fresh pool and drops the old one, with the
+ text of removed books and any mapped catalog it retained. The orders view
+ the keys, so they are rebuilt over the new text.
+ */
+void Library::compactStrings() {
+  TraceSpan span("Library::compactStrings");
+  StringPool fresh;
+  for (auto &aPair : books) {
+    aPair.second = aPair.second.pooledIn(fresh);
+  }
+  rebuildIndexes();
+  strings = std::move(fresh);
+  reclaimable = 0;
+}
+
+/*
+ makes this Library a copy of other's catalog, its text in a pool of its
+ own. Nothing is journaled or saved; a Library in read-only or remote
+ mode has no books to copy.
+ */
+void Library::assign(const Library &other) {
+  TraceSpan span("Library::assign");
+  books.clear();
+  strings = StringPool();
+  reclaimable = 0;
+  books.reserve(other.books.size());
+  for (const auto &aPair : other.books) {
+    books.try_emplace(aPair.first, aPair.second.pooledIn(strings));
+  }
+  rebuildIndexes();
 }
 
 void Library::deserialize() {
-  std::ifstream ifs("library_data.txt");
-  if (ifs.is_open()) {
+  MetricTimer timer(metricDeserialize);
+  journal.close();
+  indexed = false; // index once, after the journal's edits are applied
+  books.clear();
+  strings = StringPool(); // nothing views the old catalog's text now
+  reclaimable = 0;
+  if (!loadCatalog(catalogPath)) {
+    snapshotStale = readArchive(textPath);
+  }
+  Journal::replay(journalPath, [this](JournalOp op, Book &aBook) {
+    if (op == journalAdd) {
+      insertBook(aBook, catalogKey(aBook.getISBNView()));
+    } else {
+      eraseBook(catalogKey(aBook.getISBNView()));
+    }
+  });
+  rebuildIndexes();
+  journal.open(journalPath);
+}
+
+/*
+ makes pending edits durable. The journal is folded into a new snapshot
+ only when it has grown past a quarter of the snapshot's size, so a short
+ session costs O(edits), not a rewrite of the whole catalog.
+ */
+void Library::checkpoint() {
+  MetricTimer timer(metricCheckpoint);
+  if (readOnly() || remote()) { // the server keeps its own catalog durable
+    return;
+  }
+  if (!journal.isOpen()) {
+    serialize(); // nothing was journaled, the snapshot is all there is
+    return;
+  }
+  journal.sync();
+  struct stat st;
+  ul snapshotBytes(stat(catalogPath.c_str(), &st) == 0 ? st.st_size : 0);
+  if (snapshotStale || journal.bytes() > snapshotBytes / 4) {
+    serialize();
+  }
+}
+
+// switches the Library to serving the catalog file in place; the in-memory
+// catalog is dropped
+bool Library::openReadOnly() {
+  journal.close();
+  if (!mapped.open(catalogPath)) {
+    mapped.close();
+    return false;
+  }
+  strings.retain(mapped.storage()); // for Books copied out of results
+  books.clear();
+  titleOrder.clear();
+  authorOrder.clear();
+  isbnOrder.clear();
+  titleWords.clear();
+  authorWords.clear();
+  mappedWordsIndexed = false;
+  mappedAuthors.clear();
+  candidatesStale = true;
+  titleWidths.clear();
+  authorWidths.clear();
+  isbnWidths.clear();
+  mappedWidthsMeasured = false;
+  materialized.clear();
+  return true;
+}
+
+/*
+ switches the Library to asking the lms serve listening at socketPath
+ (see server.hpp); false, and nothing changes, if nobody answers there.
+ */
+bool Library::connect(const std::string &socketPath) {
+  if (!server.connect(socketPath)) {
+    return false;
+  }
+  journal.close();
+  fetched.clear();
+  remoteMode = true;
+  return true;
+}
+
+// remote mode: one request and its reply; false unless the server agreed
+bool Library::ask(Request code, const vSV &fields, Message &reply) const {
+  if (!server.isOpen()) {
+    server.reconnect(); // lost on an earlier call: nothing of this one sent
+  }
+  bool answered(server.call(code, fields, reply));
+  if (!answered && code != reqAdd && code != reqRemove &&
+      server.reconnect()) {
+    answered = server.call(code, fields, reply);
+  }
+  if (!answered) {
+    remoteProblem = "lost the connection to the server";
+  } else if (reply.code == statusTooLarge) {
+    remoteProblem = "the server's reply would be too large";
+  }
+  return answered && reply.code == statusOK;
+}
+
+const char *Library::takeRemoteProblem() {
+  const char *problem(remoteProblem);
+  remoteProblem = nullptr;
+  return problem;
+}
+
+// remote mode: the books in a reply, kept here one copy per ISBN
+void Library::askBooks(Request code, const vSV &fields,
+                       vpBook &results) const {
+  results.clear();
+  Message reply;
+  if (!ask(code, fields, reply)) {
+    return;
+  }
+  results.reserve(reply.fields.size() / 3);
+  for (ul i = 0; i + 2 < reply.fields.size(); i += 3) {
+    Book &kept(fetched[catalogKey(reply.fields[i + 2])]);
+    kept = Book(reply.fields[i], reply.fields[i + 1], reply.fields[i + 2],
+                strings);
+    results.emplace_back(&kept);
+  }
+}
+
+// remote mode: the titles or authors in a reply, interned to stay valid
+void Library::askNames(Request code, const vSV &fields, vSV &names) const {
+  names.clear();
+  Message reply;
+  if (!ask(code, fields, reply)) {
+    return;
+  }
+  for (std::string_view name : reply.fields) {
+    names.emplace_back(strings.intern(name));
+  }
+}
+
+bool Library::loadCatalog(const std::string &path) {
+  TraceSpan span("Library::loadCatalog");
+  CatalogReader reader;
+  if (!reader.open(path)) {
+    return false;
+  }
+  // the Books point straight into the mapped string heap, nothing is copied
+  strings.retain(reader.storage());
+  books.clear();
+  books.reserve(reader.size());
+  for (ul i = 0; i < reader.size(); i++) {
+    books.try_emplace(catalogKey(reader.isbn(i)),
+                      Book::fromPool(reader.title(i), reader.author(i),
+                                     reader.isbn(i), strings));
+  }
+  return true;
+}
+
+bool Library::importFile(const std::string &path, ImportFormat format,
+                         ImportReport &report) {
+  MetricTimer timer(metricImport);
+  const ul maxProblems(20);
+  report = ImportReport();
+  BulkReader reader;
+  if (readOnly() || remote() || !reader.open(path, format)) {
+    return false;
+  }
+  std::vector<ImportChunk> chunks;
+  reader.parse(chunks);
+  ul total(0);
+  for (const ImportChunk &chunk : chunks) {
+    total += chunk.books.size();
+  }
+  books.reserve(books.size() + total);
+  StringPool &pool(strings);
+  auto note = [&](ul where, const std::string &what) {
+    if (report.problems.size() < maxProblems) {
+      report.problems.push_back(std::string(reader.unit()) + " " +
+                                std::to_string(where) + ": " + what);
+    }
+  };
+  indexed = false; // index once, after the last batch
+  for (const ImportChunk &chunk : chunks) {
+    auto problem(chunk.problems.begin());
+    for (const ImportedBook &b : chunk.books) {
+      for (; problem != chunk.problems.end() && problem->where < b.where;
+           ++problem) {
+        note(problem->where, problem->what);
+      }
+      if (books.find(b.key) != books.end()) {
+        report.duplicates++;
+        note(b.where, "ISBN " + std::string(b.isbn) + " is already in the catalog");
+        continue;
+      }
+      std::string_view title(pool.intern(b.title));
+      std::string_view author(pool.intern(b.author));
+      books.try_emplace(
+          b.key,
+          Book::fromViews(
+              title, author, pool.intern(b.isbn),
+              b.titleKey == b.title ? title : pool.intern(b.titleKey),
+              b.authorKey == b.author ? author : pool.intern(b.authorKey)));
+      report.added++;
+    }
+    for (; problem != chunk.problems.end(); ++problem) {
+      note(problem->where, problem->what);
+    }
+    report.malformed += chunk.problems.size();
+  }
+  rebuildIndexes();
+  if (report.added > 0) {
+    // one snapshot instead of a journal record per book; should it fail,
+    // the next checkpoint tries again
+    snapshotStale = true;
+    serialize();
+  }
+  return true;
+}
+
+bool Library::exportText(const std::string &path) const {
+  return exportFile(path, exportArchive);
+}
+
+/*
+ orderCount writes the books as they are stored, which is the cheapest.
+ The archive is always written as stored, and only from the in-memory
+ catalog; its table of distinct authors is the one thing that grows with
+ the catalog.
+ */
+bool Library::exportFile(const std::string &path, ExportFormat format,
+                         CatalogOrder order) const {
+  MetricTimer timer(metricExport);
+  FileWriter out;
+  if ((format == exportArchive && readOnly()) || remote() ||
+      !out.open(path)) {
+    return false;
+  }
+  if (format == exportArchive) {
+    TraceSpan span("boost text_oarchive");
+    std::ostream os(&out);
+    boost::archive::text_oarchive oa(os);
+    oa << *this;
+  } else if (readOnly()) {
+    writeHeader(out, format);
+    for (ul i = 0; i < mapped.size(); i++) {
+      ul r(order == orderCount ? i : mapped.ordered(order, i));
+      if (r < mapped.size()) {
+        writeRecord(out, format, mapped.title(r), mapped.author(r),
+                    mapped.isbn(r));
+      }
+    }
+  } else {
+    writeHeader(out, format);
+    auto write = [&](const Book &b) {
+      writeRecord(out, format, b.getTitleView(), b.getAuthorView(),
+                  b.getISBNView());
+    };
+    if (order == orderCount) {
+      for (const auto &aPair : books) {
+        write(aPair.second);
+      }
+    } else if (order == orderISBN) {
+      for (uint64_t key : isbnOrder) {
+        write(books.find(key)->second);
+      }
+    } else {
+      for (const auto &entry : order == orderTitle ? titleOrder : authorOrder) {
+        write(books.find(entry.second)->second);
+      }
+    }
+  }
+  return out.close();
+}
+
+/*
+ replaces the catalog with the archive's books. The journal's edits were
+ made against the old catalog, so a snapshot of the new one supersedes
+ both; false if the archive could not be read or the snapshot written.
+ */
+bool Library::importText(const std::string &path) {
+  MetricTimer timer(metricImport);
+  if (readOnly() || remote()) {
+    return false;
+  }
+  // read aside, so an archive that turns out bad leaves the catalog alone
+  Library archived;
+  if (!archived.readArchive(path)) {
+    return false;
+  }
+  books = std::move(archived.books);
+  strings = std::move(archived.strings); // nothing views the old text now
+  reclaimable = 0;
+  rebuildIndexes();
+  snapshotStale = true; // until serialize writes it
+  serialize();
+  return !snapshotStale;
+}
+
+// loads books from a text archive without touching the indexes
+bool Library::readArchive(const std::string &path) {
+  std::ifstream ifs(path);
+  if (!ifs.is_open()) {
+    return false;
+  }
+  TraceSpan span("boost text_iarchive");
+  try {
     boost::archive::text_iarchive ia(ifs);
     ia >> *this;
+  } catch (const boost::archive::archive_exception &) {
+    books.clear(); // not an archive, or one cut short
+    return false;
   }
+  return true;
 }
@@ -1,33 +1,297 @@
-
 // Library.hpp
 #ifndef LIBRARY_HPP
 #define LIBRARY_HPP
 
 #include "book.hpp"
- 
+#include "bulk_export.hpp"
+#include "bulk_import.hpp"
+#include "catalog_file.hpp"
+#include "client.hpp"
+#include "field_widths.hpp"
+#include "fuzzy.hpp"
+#include "isbn.hpp"
+#include "journal.hpp"
+#include "protocol.hpp"
+#include "text.hpp"
+#include "thread_pool.hpp"
+#include "word_index.hpp"
+
+/*
+ Persistence: deserialize loads the binary snapshot, replays the journal of
+ edits made since, and from then on every addBook/removeBook is appended to
+ the journal; an edit the journal could not take is refused, not applied.
+ serialize folds the journal into a fresh snapshot; checkpoint
+ does so only once the journal has grown large relative to the snapshot.
+
+ Read-only mode (openReadOnly) serves everything straight from the mapped
+ catalog file instead: no Book is built until a search or listing returns
+ it, edits are refused, and the journal is not replayed. The Books built
+ are cached, but only up to a bound: see trimMaterialized.
+
+ Title and author searches, exact or by prefix, run over titles and
+ authors kept sorted by each Book's folded key (see text.hpp), so they
+ ignore case, accents and spacing and cost O(log n + k). Read-only mode
+ does the same over the catalog file's orders.
+
+ fuzzyAuthors finds the distinct authors within an edit distance of a
+ misspelt name (see fuzzy.hpp), comparing folded forms, closest first.
+
+ scan() is for questions no index answers (substrings, regular expressions,
+ ...): it tests a predicate against every book, split into chunks over
+ workerPool() (see thread_pool.hpp), and returns the matches in ISBN order
+ whatever the thread count. The predicate runs on several threads at once.
+
+ Word search runs over inverted indexes of the words in titles and authors
+ (see word_index.hpp), kept up to date by addBook/removeBook. Read-only
+ mode builds them from the catalog file on the first word search.
+
+ importFile reads CSV, JSON Lines or MARC (see bulk_import.hpp), parsing
+ on the worker threads. The books go in with index upkeep deferred, the
+ indexes are rebuilt once at the end, and a fresh snapshot replaces
+ journaling every book. Books whose ISBN is already in the catalog are
+ skipped, not replaced. importText instead replaces the whole catalog with
+ a boost text archive's (the .txt exportFile writes), and snapshots it
+ too; an archive that does not read to the end leaves the catalog as it
+ was. Both are refused in read-only and remote mode.
+
+ exportFile streams the catalog to CSV, JSON Lines or the boost text
+ archive (see bulk_export.hpp) in title, author or ISBN order, or as
+ stored (orderCount). Books are written straight from storage, or from
+ the mapped file in read-only mode, through one fixed buffer.
+
+ Books are keyed on the numeric ISBN-13 (see isbn.hpp), so any spelling of
+ an ISBN finds the same book; the text as entered is kept for display.
+
+ The catalog is also kept in title, author and ISBN order as books come
+ and go (see sorted_blocks.hpp), so catalogPage hands out any page of it
+ in any order in O(log n + page size), with no sorting.
+
+ fieldWidths is O(1): a histogram of each field's lengths (see
+ field_widths.hpp) is kept along with the orders. Read-only mode measures
+ the catalog file once, on first use.
+
+ Remote mode (connect) hands every call to a running lms serve (see
+ server.hpp) instead, so several sessions share one loaded catalog. The
+ books it returns are kept as they arrive, one copy per ISBN; scan()
+ pages the whole catalog over and tests it here. Import and export need
+ the catalog file and are refused, and persistence is the server's job.
+ A lost connection is opened again on the next call; a lookup that lost
+ it is asked once more, an edit is not, as the server may have made it.
+ A call that still fails, or whose reply would be too large, looks like
+ one that found nothing, so takeRemoteProblem says what went wrong.
+
+ The catalog's text lives in a StringPool the Library owns (see
+ string_pool.hpp). Text left behind by removed or replaced books is
+ counted. Once it passes half the pool, serialize (and so checkpoint)
+ moves the live books into a fresh pool and drops the old one; compact
+ does only that, for a Library that is never saved.
 
+ A Library is not safe to edit while other threads read it. assign copies
+ another's catalog, so ConcurrentLibrary (see concurrent_library.hpp) can
+ keep a second copy for readers to use meanwhile.
+
+ Search results and catalog listings are vpBook: pointers into the Library's
+ own storage, nothing is copied. A pointer stays valid until the Library is
+ next modified (addBook, removeBook, deserialize); copy the Book first if it
+ must outlive such a call. A copied Book still views the Library's pool,
+ which serialize, checkpoint and deserialize may replace; copy its text
+ (getTitle, ...) to keep it past those. In read-only mode a pointer may
+ also be dropped by a later call that returns books, so use results
+ before asking again.
+ */
 class Library {
 public:
-  bool empty();
-  ul size();
-  umB getAllBooks() { return books; }
-  void addBook(Book &);
+  bool empty() const;
+  ul size() const;
+  const umB &getAllBooks() const { return books; }
+  const StringPool &stringPool() const { return strings; }
+  bool addBook(Book &);
+  bool addBook(std::string_view title, std::string_view author,
+               std::string_view isbn);
+  void catalog(vpBook &results) const;
+  void catalogPage(CatalogOrder order, ul first, ul count,
+                   vpBook &page) const;
+  void fieldWidths(ul &title, ul &author, ul &isbn) const;
   void displayAllBooks();
   bool removeBook(Book &aBook);
-  void searchByAuthor(std::string &author, std::vector<Book> &results);
-  void searchByTitle(std::string &title, std::vector<Book> &results);
-  void searchByISBN(std::string &ispn, std::vector<Book> &results);
+  bool removeBook(std::string_view isbn);
+  void searchByAuthor(std::string_view author, vpBook &results) const;
+  void searchByTitle(std::string_view title, vpBook &results) const;
+  void searchByISBN(std::string_view isbn, vpBook &results) const;
+  void searchByTitlePrefix(std::string_view prefix, ul k,
+                           vpBook &results) const;
+  void searchByAuthorPrefix(std::string_view prefix, ul k,
+                            vpBook &results) const;
+  void searchByWords(std::string_view query, vpBook &results) const;
+  void fuzzyAuthors(std::string_view author, ul maxDistance, ul k,
+                    vSV &authors) const;
+  void scan(const BookPredicate &match, vpBook &results) const;
+  void completeTitle(std::string_view prefix, ul k, vSV &titles) const;
+  void completeAuthor(std::string_view prefix, ul k, vSV &authors) const;
   void serialize();
   void deserialize();
+  void checkpoint();
+  void compact();
+  void assign(const Library &other);
+  bool openReadOnly();
+  bool readOnly() const { return mapped.isOpen(); }
+  bool connect(const std::string &socketPath);
+  bool remote() const { return remoteMode; }
+  // what made a remote call fail since last asked, or nullptr; clears it
+  const char *takeRemoteProblem();
+  void setJournalSyncEvery(ul n) { journal.setSyncEvery(n); }
+  bool exportText(const std::string &path) const;
+  bool exportFile(const std::string &path, ExportFormat format,
+                  CatalogOrder order = orderCount) const;
+  bool importText(const std::string &path);
+  bool importFile(const std::string &path, ImportFormat format,
+                  ImportReport &report);
+
+  friend class boost::serialization::access;
 
-  // Serialization function 
+  /*
+   Serialization functions. Version 1 writes each distinct author once and
+   has books refer to it by number; version 0 was the plain ISBN -> Book map.
+   */
   template <class Archive>
-  void serialize(Archive &ar, const unsigned int version) {
-    ar &books;
+  void save(Archive &ar, const unsigned int) const {
+    std::unordered_map<std::string_view, ul> authorIds;
+    vString authors;
+    for (const auto &aPair : books) {
+      std::string_view author(aPair.second.getAuthorView());
+      if (authorIds.try_emplace(author, authors.size()).second) {
+        authors.emplace_back(author);
+      }
+    }
+    ul count(books.size());
+    ar &authors;
+    ar &count;
+    for (const auto &aPair : books) {
+      std::string title(aPair.second.getTitleView());
+      std::string isbn(aPair.second.getISBNView());
+      ul authorId(authorIds[aPair.second.getAuthorView()]);
+      ar &title;
+      ar &authorId;
+      ar &isbn;
+    }
+  }
+
+  template <class Archive> void load(Archive &ar, const unsigned int version) {
+    books.clear();
+    if (version == 0) {
+      std::unordered_map<std::string, Book> legacy;
+      ar &legacy;
+      for (const auto &aPair : legacy) {
+        books.try_emplace(catalogKey(aPair.second.getISBNView()),
+                          aPair.second.pooledIn(strings));
+      }
+      return;
+    }
+    vString authors;
+    ul count;
+    ar &authors;
+    ar &count;
+    std::vector<std::string_view> pooled;
+    for (const std::string &author : authors) {
+      pooled.emplace_back(strings.intern(author));
+    }
+    books.reserve(count);
+    std::string title, isbn;
+    ul authorId;
+    for (ul i = 0; i < count; i++) {
+      ar &title;
+      ar &authorId;
+      ar &isbn;
+      if (authorId >= pooled.size()) {
+        throw boost::archive::archive_exception(
+            boost::archive::archive_exception::input_stream_error);
+      }
+      Book aBook(title, pooled[authorId], isbn, strings);
+      books.try_emplace(catalogKey(aBook.getISBNView()), aBook);
+    }
   }
 
+  BOOST_SERIALIZATION_SPLIT_MEMBER()
+
 private:
-  umB books;
+  // one per distinct author, for fuzzyAuthors
+  struct AuthorCandidate {
+    std::string_view folded;
+    uint64_t key;       // the author's first book (record when read-only)
+    uint64_t signature; // see byteSignature
+  };
+
+  void insertBook(const Book &, uint64_t key);
+  bool eraseBook(uint64_t key);
+  void indexBook(const Book &, uint64_t key);
+  void unindexBook(const Book &, uint64_t key);
+  void rebuildIndexes();
+  void searchOrder(const sbSK &, std::string_view, vpBook &) const;
+
+  void searchPrefix(const sbSK &, CatalogOrder, std::string_view, ul,
+                    vpBook &) const;
+  void completePrefix(const sbSK &, CatalogOrder, std::string_view, ul,
+                      vSV &) const;
+
+  bool loadCatalog(const std::string &path);
+  bool readArchive(const std::string &path);
+  void compactStrings();
+  const Book *materialize(ul record) const;
+  void trimMaterialized() const;
+  void searchMapped(CatalogOrder, std::string_view, vpBook &) const;
+  void indexMappedWords() const;
+  const sbSK &distinctAuthors() const;
+  const std::vector<AuthorCandidate> &authorCandidates() const;
+  bool ask(Request, const vSV &, Message &) const;
+  void askBooks(Request, const vSV &, vpBook &) const;
+  void askNames(Request, const vSV &, vSV &) const;
+
+  std::string catalogPath = "library_data.lms"; // binary snapshot
+  std::string textPath = "library_data.txt";    // boost text archive
+  std::string journalPath = "library_data.journal";
+
+  // read-only mode: a Book built over a mapped record, with its keys
+  struct MappedBook {
+    std::string titleKey;
+    std::string authorKey;
+    Book book;
+  };
+  static const ul materializedLimit = 1 << 16;
+  static const ul compactMinimum = 1 << 20; // bytes worth reclaiming
+
+  Journal journal;
+  CatalogReader mapped;                                     // read-only mode
+  mutable std::unordered_map<ul, MappedBook> materialized; // record -> Book
+  mutable LibraryClient server;                       // remote mode
+  mutable std::unordered_map<uint64_t, Book> fetched; // ISBN-13 key -> Book
+  bool remoteMode = false; // stays set if the server goes away
+  mutable const char *remoteProblem = nullptr;
+  bool snapshotStale = false; // from the text archive or an older catalog
+
+  mutable StringPool strings; // the catalog's text; see compactStrings
+  ul reclaimable = 0;         // bytes in strings no book views any more
+  umB books;         // ISBN-13 key -> Book
+  sbSK titleOrder;   // (folded title, ISBN-13 key), sorted
+  sbSK authorOrder;  // (folded author, ISBN-13 key), sorted
+  sbKey isbnOrder;   // ISBN-13 keys, sorted
+  // words -> ISBN-13 key; in read-only mode -> record, built on first use
+  mutable WordIndex titleWords;
+  mutable WordIndex authorWords;
+  mutable bool mappedWordsIndexed = false;
+  mutable sbSK mappedAuthors; // read-only: (folded author, record), sorted
+  // fuzzyAuthors' list, built on first use after an edit. The lock keeps
+  // concurrent lookups from building it twice; edits never run alongside
+  mutable std::vector<AuthorCandidate> candidates; // by folded length
+  mutable bool candidatesStale = true;
+  mutable std::mutex candidatesLock;
+  // field lengths; in read-only mode measured on first use
+  mutable WidthHistogram titleWidths;
+  mutable WidthHistogram authorWidths;
+  mutable WidthHistogram isbnWidths;
+  mutable bool mappedWidthsMeasured = false;
+  bool indexed = true; // false while a load defers index upkeep
 };
 
+BOOST_CLASS_VERSION(Library, 1)
+
 #endif // LIBRARY_HPP
@@ -5,30 +5,74 @@ class Book; // foward reference
 
 #include <_ctype.h>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
 #include <boost/archive/text_iarchive.hpp>
 #include <boost/archive/text_oarchive.hpp>
+#include <boost/serialization/split_member.hpp>
 #include <boost/serialization/string.hpp>
 #include <boost/serialization/unordered_map.hpp>
+#include <boost/serialization/vector.hpp>
+#include <boost/serialization/version.hpp>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <curses.h>
+#include <deque>
+#include <fcntl.h>
 #include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <numeric>
 #include <ncurses.h>
+#include <poll.h>
 #include <random>
+#include <regex>
 #include <signal.h>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
 #include <unistd.h>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
 
-typedef std::unordered_map<std::string, Book> umB;
 typedef std::vector<Book> vBook;
 typedef std::vector<std::string> vString;
 typedef std::vector<vBook> vvBook;
+typedef std::vector<const Book *> vpBook;
+typedef std::function<bool(const Book &)> BookPredicate;
 typedef unsigned long ul;
 
+#include "hash.hpp"
+#include "sorted_blocks.hpp"
+
+typedef std::unordered_map<uint64_t, Book> umB;
+typedef std::vector<std::pair<std::string_view, uint64_t>> vSK;
+typedef std::vector<std::string_view> vSV;
+typedef std::vector<uint64_t> vKey;
+typedef SortedBlocks<std::pair<std::string_view, uint64_t>> sbSK;
+typedef SortedBlocks<uint64_t> sbKey;
+
 #endif // !LMS_PROJECT_HPP
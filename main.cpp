@@ -55,7 +55,10 @@ instructions on how to run your program.
 */
 
 #include "book.hpp"
+#include "cli.hpp"
 #include "library.hpp"
+#include "metrics.hpp"
+#include "trace.hpp"
 #include <cstdio>
 #include <iostream>
 #include <ncurses.h>
@@ -71,60 +74,84 @@ int maxSizeInVector(vString);
 int midColInWin(WINDOW *);
 int midRowInWin(WINDOW *);
 void addBookToLibrary(Library &);
+ul booksPerPage();
+void catalogSizing(int &, int &, int &, int &, int &, int &, int &);
+bool refuseWhenReadOnly(Library &);
 void clearScreen();
-void displayBook(WINDOW *, Book &, int r = 5, int t = 1, int a = 23, int i = 45,
+void displayBook(WINDOW *, const Book &, int r = 5, int t = 1, int a = 23, int i = 45,
                  int = 18);
 void displayBookPrompt(WINDOW *);
 void displayCatalog(Library &);
-void displayCurrentPage(vBook, int, int, int, int, int = 3);
+void displayCatalogPages(Library &);
+void displayCurrentPage(const vpBook &, int, int, int, int, int = 3);
 void displayHeader(WINDOW *, int = 3, int = 1, int = 23, int = 45, int = -1);
 void displayHelp();
 void displayMenu();
-void displayOneBook(Book &);
+void displayOneBook(const Book &);
 void displayPaginationMessage(int, int, int);
 void displayStringAtCenter(WINDOW *, std::string, int);
 void displayWindowSizes();
-void displyBookVector(vBook &);
-void getAuthor(Book &, char buff[512]);
+void displyBookVector(vpBook &);
+typedef std::function<void(std::string_view, vSV &)> Completer;
+// fills page with count books starting at position first of what is shown
+typedef std::function<void(ul first, ul count, vpBook &page)> PageSource;
+// puts what is shown in title ('t'), author ('a') or ISBN ('i') order
+typedef std::function<void(int)> Reorder;
+void browsePages(ul, int, int, int, const PageSource &, const Reorder &);
+
+void getAuthor(Book &, char buff[512], const Completer & = nullptr);
 void getBookData(WINDOW *, Book &);
+void getFileName(char buff[512]);
 void getISBN(Book &, char buff[512]);
-void getMinColSizes(vBook &, int &, int &, int &);
-void getTitle(Book &, char buff[512]);
+void getMinColSizes(const vpBook &, int &, int &, int &);
+void getLineWithCompletion(WINDOW *, int, int, char buff[512],
+                           const Completer &);
+void getTitle(Book &, char buff[512], const Completer & = nullptr);
+void exportBooks(Library &);
 void handleResize(int signal);
-void paginate(const vBook &, vvBook &);
+void importBooks(Library &);
+int readKey();
+int readPageNumber(int, int);
 void removeBookFromLibrary(Library &);
+void reportRemoteProblem(Library &);
 void resetIWin();
 void resetMWin();
 void resetOWin();
 void resetScreen();
-void resizeWhileInCatalog(vBook &, vvBook &, int &, int);
 void searchUsingAuthor(Library &);
 void searchUsingISBN(Library &);
+void searchUsingPattern(Library &);
 void searchUsingTitle(Library &);
-void sortCatalogAuthor(vBook &books, vvBook &pages, int &cpn, int maxLn);
-void sortCatalogISBN(vBook &books, vvBook &pages, int &cpn, int maxLn);
-void sortCatalogTitle(vBook &books, vvBook &pages, int &cpn, int maxLn);
+void searchUsingWords(Library &);
 void tag(WINDOW *, std::string, int r = 1);
 void tuiLoop(Library &);
+void windowCells(WINDOW *, std::vector<chtype> &);
 
 // global variables
+const ul prefixHits(1000); // most books a prefix search lists
 WINDOW *oWin;
 WINDOW *mWin;
 WINDOW *iWin;
 vString jokes;
 
 /* main
-   gets: usual cli parameters which are ignored
-   returns: int 0
-   set curses with three windows, loads library data, enters tui looop, stores
-   library, terminates curses, and clears the screen.
+   gets: usual cli parameters; "--kiosk" serves the catalog read-only from
+   the mapped catalog file; "--connect SOCKET" uses a running lms serve
+   (see server.hpp); a command (see cli.hpp) runs without curses
+   returns: int 0, or the command's exit status
+   set curses with three windows, loads library data, enters tui looop, makes
+   pending edits durable, terminates curses, writes $LMS_METRICS and
+   $LMS_TRACE if set (see metrics.hpp, trace.hpp), and clears the screen.
  */
 int main(int argc, char *argv[]) {
+  if (isCommandLine(argc, argv)) {
+    return runCommandLine(argc, argv);
+  }
   initscr();
-  refresh();
   cbreak();
   noecho();
   erase();
+  refresh();
 
   std::string dj0("Did you hear about the mathematician who's afraid of "
                   "negative numbers? He'll stop at nothing to avoid them!");
@@ -178,33 +205,52 @@ int main(int argc, char *argv[]) {
     resetOWin();
     resetMWin();
     resetIWin();
-    refresh();
   }
 
   Library dLibrary;
-  dLibrary.deserialize();
+  bool kiosk(false);
+  std::string server; // a running lms serve to ask instead of loading
+  for (int i = 1; i < argc; i++) { // only TUI options, or it was a command
+    if (std::string(argv[i]) == "--connect") {
+      server = argv[++i];
+    } else {
+      kiosk = true;
+    }
+  }
+  if (!server.empty()) {
+    if (!dLibrary.connect(server)) {
+      endwin();
+      fprintf(stderr, "lms: no server at %s\n", server.c_str());
+      return 1;
+    }
+  } else if (!kiosk || !dLibrary.openReadOnly()) {
+    dLibrary.deserialize();
+  }
 
   tuiLoop(dLibrary);
 
-  dLibrary.serialize();
+  dLibrary.checkpoint();
 
   endwin();
 
+  saveMetrics();
+  saveTrace();
+
   std::system("clear");
   return 0;
 }
 
 void handleResize(int signal) {
+  TraceSpan span(__func__);
   std::random_device rd;
   std::mt19937 generator(rd());
   std::shuffle(jokes.begin(), jokes.end(), generator);
   if (signal == KEY_RESIZE) {
 
     int screenWidth, screenHeight;
+    // curses has already resized the screen before handing out KEY_RESIZE
     getmaxyx(stdscr, screenHeight, screenWidth);
 
-    resizeterm(screenHeight, screenWidth);
-
     if (screenHeight < 24 || screenWidth < 112) {
       displayStringAtCenter(oWin, "HELP!", midRowInWin(oWin) - 1);
       displayStringAtCenter(
@@ -214,8 +260,7 @@ void handleResize(int signal) {
       snprintf(buff, 256, "Now, I have %d rows x %d cols", screenHeight,
                screenWidth);
       displayStringAtCenter(oWin, buff, midRowInWin(oWin) + 1);
-      refresh();
-      int ch = getch();
+      readKey();
     }
     int iShare(5);
     int oShare(screenHeight - 10);
@@ -235,22 +280,51 @@ void handleResize(int signal) {
 }
 
 /* tuiLoop
-
+   gets: Library
+   returns: nothing
+   objective: show the menu, read a key and run its handler, until 'x'
+   method: a handler's output stays on the screen until the next key.
+   Once that key arrives, the menu goes back in the output window over
+   empty message and input windows, and the key's handler draws on that.
+   Each window's cells are kept as the loop last drew them, and a window is
+   erased and drawn again only when a handler has drawn over it since; a
+   key that changes nothing draws nothing but the borders. readKey's
+   doupdate then sends only the cells that differ.
  */
-
 void tuiLoop(Library &dLibrary) {
+  std::vector<chtype> menu, messages, input, now;
   int ch('h');
+  displayMenu();
+  resetOWin();
+  windowCells(oWin, menu);
   do {
     curs_set(0);
     move(0, 0);
-    resetScreen();
-    displayMenu();
-    wrefresh(oWin);
-    ch = getch();
-    werase(mWin);
-    resetMWin();
-    werase(iWin);
+    resetMWin(); // handlers may erase the borders with what they showed
     resetIWin();
+    ch = readKey();
+    windowCells(oWin, now);
+    if (now != menu) {
+      wbkgd(oWin, COLOR_PAIR(1));
+      werase(oWin);
+      displayMenu();
+      resetOWin();
+      windowCells(oWin, menu);
+    }
+    windowCells(mWin, now);
+    if (now != messages) {
+      wbkgd(mWin, COLOR_PAIR(3)); // a handler may have left it red
+      werase(mWin);
+      resetMWin();
+      windowCells(mWin, messages);
+    }
+    windowCells(iWin, now);
+    if (now != input) {
+      wbkgd(iWin, COLOR_PAIR(1));
+      werase(iWin);
+      resetIWin();
+      windowCells(iWin, input);
+    }
     if (ch == ERR) {
     } else if (ch == KEY_RESIZE) {
       handleResize(ch);
@@ -260,10 +334,18 @@ void tuiLoop(Library &dLibrary) {
       displayCatalog(dLibrary);
     } else if (ch == 'a') {
       addBookToLibrary(dLibrary);
+    } else if (ch == 'm') {
+      importBooks(dLibrary);
+    } else if (ch == 'e') {
+      exportBooks(dLibrary);
     } else if (ch == 't') {
       searchUsingTitle(dLibrary);
     } else if (ch == 's') {
       searchUsingAuthor(dLibrary);
+    } else if (ch == 'w') {
+      searchUsingWords(dLibrary);
+    } else if (ch == 'g') {
+      searchUsingPattern(dLibrary);
     } else if (ch == 'r') {
       removeBookFromLibrary(dLibrary);
     } else if (ch == 'h') {
@@ -275,9 +357,44 @@ void tuiLoop(Library &dLibrary) {
     } else {
       displayHelp();
     }
+    reportRemoteProblem(dLibrary);
   } while (true);
 }
 
+/* readKey
+   gets: nothing
+   returns: int key
+   objective: put the frame drawn since the last key on the terminal, then
+   wait for the next key
+   method: drawing only marks windows with wnoutrefresh; the one doupdate
+   here sends the cells that differ from what the terminal shows, in a
+   single write, so a window erased and drawn again costs nothing when it
+   comes out the same. The time from the previous key arriving to this
+   doupdate is recorded as that key's frame.
+ */
+int readKey() {
+  static std::chrono::steady_clock::time_point keyArrived;
+  static bool framePending(false);
+  {
+    TraceSpan span("doupdate");
+    doupdate();
+  }
+  if (framePending) {
+    metric(metricFrame)
+        .record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - keyArrived)
+                    .count());
+  }
+  int ch;
+  {
+    TraceSpan span("wait for key");
+    ch = getch();
+  }
+  framePending = ch != ERR;
+  keyArrived = std::chrono::steady_clock::now();
+  return ch;
+}
+
 void clearScreen() {
   werase(oWin);
   werase(mWin);
@@ -295,8 +412,12 @@ void resetScreen() {
 }
 
 void addBookToLibrary(Library &aLibrary) {
+  TraceSpan span(__func__);
+  if (refuseWhenReadOnly(aLibrary)) {
+    return;
+  }
   Book aBook;
-  vBook results;
+  vpBook results;
   int resp;
   werase(mWin);
   resetMWin();
@@ -304,21 +425,29 @@ void addBookToLibrary(Library &aLibrary) {
   std::string tmp(aBook.getISBN());
   aLibrary.searchByISBN(tmp, results);
   char buff[512];
-  if (results.empty()) {
+  uint64_t key;
+  if (!parseISBN(tmp, key)) {
+    snprintf(buff, 127, "%s is not a valid ISBN-10 or ISBN-13.", tmp.c_str());
+    displayStringAtCenter(mWin, buff, midRowInWin(mWin));
+  } else if (results.empty()) {
     snprintf(buff, 127,
              "This will add to your collection of %lu books. Procede? (Y/n)",
              aLibrary.size());
     displayOneBook(aBook);
     resetMWin();
     mvwprintw(mWin, 0, 9, buff);
-    wrefresh(mWin);
-    resp = getch();
+    resp = readKey();
     if (resp != 'Y') {
       clearScreen();
       return;
     }
     displayOneBook(aBook);
-    aLibrary.addBook(aBook);
+    if (!aLibrary.addBook(aBook)) {
+      wbkgd(mWin, COLOR_PAIR(2));
+      displayStringAtCenter(
+          mWin, "The edit could not be recorded; the book was not added.",
+          midRowInWin(mWin));
+    }
   } else {
     snprintf(buff, 127,
              "A book with that ISBN already is in your collection. The old "
@@ -329,100 +458,352 @@ void addBookToLibrary(Library &aLibrary) {
   resetMWin();
 }
 
+/* importBooks
+   gets: Library
+   returns: nothing
+   objective: add every book in a CSV, JSON Lines or MARC file at once,
+   then say how many went in and list the first records that were skipped;
+   or, once the user agrees, replace the catalog with a .txt archive's
+ */
+void importBooks(Library &aLibrary) {
+  TraceSpan span(__func__);
+  if (refuseWhenReadOnly(aLibrary)) {
+    return;
+  }
+  char buff[512];
+  displayStringAtCenter(
+      mWin, "Enter the file to import (.csv, .jsonl, .mrc or .txt).", 1);
+  getFileName(buff);
+  clearScreen();
+  std::string path(buff);
+  ImportFormat format;
+  ImportReport report;
+  if (!importFormatFor(path, format)) {
+    mvwprintw(mWin, 1, 9, "%s is not a .csv, .jsonl, .mrc or .txt file.",
+              path.c_str());
+    return;
+  }
+  if (format == importTextArchive) {
+    snprintf(buff, 127,
+             "This replaces your collection of %lu books with the archive's. "
+             "Procede? (Y/n)",
+             aLibrary.size());
+    mvwprintw(mWin, 1, 9, "%s", buff);
+    if (readKey() != 'Y') {
+      clearScreen();
+      return;
+    }
+    clearScreen();
+    if (!aLibrary.importText(path)) {
+      mvwprintw(mWin, 1, 9, "Could not read %s.", path.c_str());
+      return;
+    }
+    snprintf(buff, 127, "The collection is now the archive's %lu books.",
+             aLibrary.size());
+    displayStringAtCenter(mWin, buff, 1);
+    return;
+  }
+  if (!aLibrary.importFile(path, format, report)) {
+    mvwprintw(mWin, 1, 9, "Could not read %s.", path.c_str());
+    return;
+  }
+  snprintf(buff, 255,
+           "Added %lu books. Skipped %lu already in the collection and %lu "
+           "malformed.",
+           report.added, report.duplicates, report.malformed);
+  displayStringAtCenter(mWin, buff, 1);
+  snprintf(buff, 127, "The collection is up to %lu books.", aLibrary.size());
+  displayStringAtCenter(mWin, buff, 2);
+  int r(2);
+  int maxW(getmaxx(oWin) - 4);
+  for (const std::string &p : report.problems) {
+    if (r >= getmaxy(oWin) - 1) {
+      break;
+    }
+    mvwaddnstr(oWin, r++, 2, p.c_str(), std::min<int>(p.size(), maxW));
+  }
+  resetOWin();
+}
+
+/* exportBooks
+   gets: Library
+   returns: nothing
+   objective: write the whole catalog to a CSV, JSON Lines or boost text
+   archive file, in the order the user picks
+ */
+void exportBooks(Library &aLibrary) {
+  TraceSpan span(__func__);
+  char buff[512];
+  displayStringAtCenter(
+      mWin, "Enter the file to export to (.csv, .jsonl, .tsv or .txt).", 1);
+  getFileName(buff);
+  clearScreen();
+  std::string path(buff);
+  ExportFormat format;
+  if (!exportFormatFor(path, format)) {
+    mvwprintw(mWin, 1, 9, "%s is not a .csv, .jsonl, .tsv or .txt file.",
+              path.c_str());
+    return;
+  }
+  CatalogOrder order(orderCount);
+  if (format != exportArchive) {
+    displayStringAtCenter(mWin,
+                          "Sort by 't' Title, 'a' Author or 'i' Isbn; any "
+                          "other key keeps the stored order.",
+                          1);
+    int ch(readKey());
+    order = ch == 't'   ? orderTitle
+            : ch == 'a' ? orderAuthor
+            : ch == 'i' ? orderISBN
+                        : orderCount;
+    werase(mWin);
+    resetMWin();
+  }
+  if (aLibrary.exportFile(path, format, order)) {
+    mvwprintw(mWin, 1, 9, "Wrote %lu books to %s.", aLibrary.size(),
+              path.c_str());
+  } else {
+    mvwprintw(mWin, 1, 9, "Could not write %s.", path.c_str());
+  }
+}
+
 void removeBookFromLibrary(Library &aLibrary) {
+  TraceSpan span(__func__);
+  if (refuseWhenReadOnly(aLibrary)) {
+    return;
+  }
   Book aBook;
-  vBook results;
+  vpBook results;
   char buff[512];
   getISBN(aBook, buff);
   clearScreen();
-  std::string tmp = aBook.getISBN();
-  aLibrary.searchByISBN(tmp, results);
+  aLibrary.searchByISBN(aBook.getISBNView(), results);
   if (results.empty()) {
     wbkgd(mWin, COLOR_PAIR(2));
     mvwprintw(mWin, midRowInWin(mWin), 2,
               "Book with ISBN of %s is not in catalog.",
               aBook.getISBN().c_str());
-  } else if (aLibrary.removeBook(aBook)) {
+  } else {
+    Book removed(*results.front()); // removeBook invalidates results
+    if (!aLibrary.removeBook(aBook)) {
+      wbkgd(mWin, COLOR_PAIR(2));
+      displayStringAtCenter(
+          mWin, "The edit could not be recorded; the book was not removed.",
+          midRowInWin(mWin));
+      wnoutrefresh(mWin);
+      return;
+    }
     displayHeader(mWin, 1);
-    displayBook(mWin, results.front(), midRowInWin(mWin));
+    displayBook(mWin, removed, midRowInWin(mWin));
     char buff[512];
     snprintf(buff, 127, "The collection is down to %lu books.",
              aLibrary.size());
     tag(mWin, buff, midRowInWin(mWin));
   }
-  wrefresh(mWin);
+  wnoutrefresh(mWin);
+}
+
+/* reportRemoteProblem
+   gets: Library
+   returns: nothing
+   objective: with --connect, say when a request to the server failed, so
+   an empty result is not taken for no match
+ */
+void reportRemoteProblem(Library &aLibrary) {
+  const char *problem(aLibrary.takeRemoteProblem());
+  if (!problem) {
+    return;
+  }
+  mvwprintw(mWin, getmaxy(mWin) - 2, 2, "Server: %s.", problem);
+  resetMWin();
+}
+
+/* refuseWhenReadOnly
+   gets: Library
+   returns: bool
+   objective: tell the user edits are disabled on a kiosk (read-only) catalog
+ */
+bool refuseWhenReadOnly(Library &aLibrary) {
+  if (!aLibrary.readOnly()) {
+    return false;
+  }
+  clearScreen();
+  displayStringAtCenter(mWin, "This catalog is read-only.", midRowInWin(mWin));
+  return true;
 }
 
 void searchUsingTitle(Library &aLibrary) {
+  TraceSpan span(__func__);
   Book aBook;
   char buff[512];
-  getTitle(aBook, buff);
-  std::string tmp = aBook.getTitle();
+  getTitle(aBook, buff, [&aLibrary](std::string_view prefix, vSV &titles) {
+    aLibrary.completeTitle(prefix, getmaxy(oWin) - 5, titles);
+  });
   clearScreen();
   resetScreen();
-  vBook results;
-  aLibrary.searchByTitle(tmp, results);
+  vpBook results;
+  aLibrary.searchByTitle(aBook.getTitleView(), results);
+  if (results.empty()) { // maybe it is the start of one or more titles
+    aLibrary.searchByTitlePrefix(aBook.getTitleView(), prefixHits, results);
+  }
   if (results.empty()) {
     mvwprintw(mWin, 1, 9, "Book with title of %s is not in catalog.",
               aBook.getTitle().c_str());
   } else if (results.size() == 1) {
-    displayOneBook(results.front());
+    displayOneBook(*results.front());
   } else {
     displyBookVector(results);
   }
 }
 
 void searchUsingAuthor(Library &aLibrary) {
+  TraceSpan span(__func__);
   char buff[512];
   Book aBook;
-  getAuthor(aBook, buff);
+  getAuthor(aBook, buff, [&aLibrary](std::string_view prefix, vSV &authors) {
+    aLibrary.completeAuthor(prefix, getmaxy(oWin) - 5, authors);
+  });
   clearScreen();
   resetScreen();
-  std::string tmp(aBook.getAuthor());
-  vBook results;
-  aLibrary.searchByAuthor(tmp, results);
+  vpBook results;
+  std::string author(aBook.getAuthor());
+  aLibrary.searchByAuthor(author, results);
+  if (results.empty()) { // maybe it is the start of an author's name
+    aLibrary.searchByAuthorPrefix(author, prefixHits, results);
+  }
+  vSV nearby;
+  if (results.empty()) { // or misspelt: show the closest author's books
+    aLibrary.fuzzyAuthors(author, typosAllowed(author), 4, nearby);
+    if (!nearby.empty()) {
+      author = nearby.front();
+      aLibrary.searchByAuthor(author, results);
+    }
+  }
   if (results.empty()) {
     mvwprintw(mWin, 2, 9, "Nothing written by %s was found.",
               aBook.getAuthor().c_str());
-  } else if (results.size() == 1) {
-    displayOneBook(results.front());
+    return;
+  }
+  if (!nearby.empty()) {
+    std::string s1("No author " + aBook.getAuthor() + ". Did you mean");
+    for (ul i = 0; i < nearby.size(); i++) {
+      s1 += (i ? ", " : " ") + std::string(nearby[i]);
+    }
+    displayStringAtCenter(mWin, s1 + "?", 1);
+  }
+  if (results.size() == 1) {
+    displayOneBook(*results.front());
   } else {
-    std::string s0("Books by " + aBook.getAuthor() + ":");
+    std::string s0("Books by " + author + ":");
     displayStringAtCenter(oWin, s0, 1);
     std::sort(results.begin(), results.end(),
-              [](const Book &book1, const Book &book2) {
-                return book1.getTitle() < book2.getTitle();
+              [](const Book *book1, const Book *book2) {
+                return book1->getTitleKey() < book2->getTitleKey();
               });
     displyBookVector(results);
   }
 }
 
+/* searchUsingWords
+   gets: Library
+   returns: nothing
+   objective: list the books whose title or author holds every word typed
+   on the title line, best match first.
+ */
+void searchUsingWords(Library &aLibrary) {
+  TraceSpan span(__func__);
+  Book aBook;
+  char buff[512];
+  displayStringAtCenter(mWin, "Enter words from a title or author.", 1);
+  getTitle(aBook, buff);
+  clearScreen();
+  resetScreen();
+  vpBook results;
+  aLibrary.searchByWords(aBook.getTitleView(), results);
+  if (results.empty()) {
+    mvwprintw(mWin, 1, 9, "No book matches all of %s.",
+              aBook.getTitle().c_str());
+  } else if (results.size() == 1) {
+    displayOneBook(*results.front());
+  } else {
+    displyBookVector(results);
+  }
+}
+
+/* searchUsingPattern
+   gets: Library
+   returns: nothing
+   objective: list the books with a title, author or ISBN matching a
+   regular expression typed on the title line, ignoring case. No index
+   helps here, so every book is tested, on all cores.
+ */
+void searchUsingPattern(Library &aLibrary) {
+  TraceSpan span(__func__);
+  Book aBook;
+  char buff[512];
+  displayStringAtCenter(mWin, "Enter a pattern to find in any field.", 1);
+  getTitle(aBook, buff);
+  clearScreen();
+  resetScreen();
+  std::regex pattern;
+  try {
+    pattern.assign(aBook.getTitle(), std::regex::ECMAScript |
+                                         std::regex::icase |
+                                         std::regex::optimize);
+  } catch (const std::regex_error &) {
+    mvwprintw(mWin, 1, 9, "%s is not a valid pattern.",
+              aBook.getTitle().c_str());
+    return;
+  }
+  auto found = [&pattern](std::string_view s) {
+    return std::regex_search(s.begin(), s.end(), pattern);
+  };
+  vpBook results;
+  aLibrary.scan(
+      [&found](const Book &b) {
+        return found(b.getTitleView()) || found(b.getAuthorView()) ||
+               found(b.getISBNView());
+      },
+      results);
+  if (results.empty()) {
+    mvwprintw(mWin, 1, 9, "No book matches %s.", aBook.getTitle().c_str());
+  } else if (results.size() == 1) {
+    displayOneBook(*results.front());
+  } else {
+    displyBookVector(results);
+  }
+}
+
 void searchUsingISBN(Library &aLibrary) {
+  TraceSpan span(__func__);
   Book aBook;
   char buff[512];
   getISBN(aBook, buff);
-  std::string tmp = aBook.getISBN();
   clearScreen();
   resetScreen();
-  vBook results;
-  aLibrary.searchByISBN(tmp, results);
+  vpBook results;
+  aLibrary.searchByISBN(aBook.getISBNView(), results);
   if (results.empty()) {
     mvwprintw(mWin, 3, 9, "Book with ISBN of %s is not in catalog.",
               aBook.getISBN().c_str());
   } else if (results.size() == 1) {
-    displayOneBook(results.front());
+    displayOneBook(*results.front());
   } else {
     displyBookVector(results);
   }
 }
 
-void getTitle(Book &aBook, char buff[512]) {
+void getTitle(Book &aBook, char buff[512], const Completer &complete) {
   displayBookPrompt(iWin);
   resetIWin();
   echo();
   curs_set(1);
   wmove(iWin, 1, 9);
-  wgetstr(iWin, buff);
+  if (complete) {
+    getLineWithCompletion(iWin, 1, 9, buff, complete);
+  } else {
+    wgetstr(iWin, buff);
+  }
   noecho();
   curs_set(0);
   aBook.setTitle(buff);
@@ -430,13 +811,17 @@ void getTitle(Book &aBook, char buff[512]) {
   resetIWin();
 }
 
-void getAuthor(Book &aBook, char buff[512]) {
+void getAuthor(Book &aBook, char buff[512], const Completer &complete) {
   displayBookPrompt(iWin);
   resetIWin();
   echo();
   curs_set(1);
   wmove(iWin, 2, 9);
-  wgetstr(iWin, buff);
+  if (complete) {
+    getLineWithCompletion(iWin, 2, 9, buff, complete);
+  } else {
+    wgetstr(iWin, buff);
+  }
   noecho();
   curs_set(0);
   aBook.setAuthor(buff);
@@ -458,14 +843,95 @@ void getISBN(Book &aBook, char buff[512]) {
   resetIWin();
 }
 
+/* getFileName
+   gets: buffer
+   returns: nothing
+   objective: read a file name into buff. Unlike getTitle it builds no
+   Book, whose text would stay in the catalog's string pool for good
+ */
+void getFileName(char buff[512]) {
+  werase(iWin);
+  mvwprintw(iWin, 1, 3, "File: ");
+  resetIWin();
+  echo();
+  curs_set(1);
+  wmove(iWin, 1, 9);
+  wgetnstr(iWin, buff, 511);
+  noecho();
+  curs_set(0);
+  resetIWin();
+}
+
+/* getLineWithCompletion
+   gets: WINDOW pointer, row & column of the input field, buffer, completer
+   returns: nothing
+   objective: read a line like wgetstr does, while listing the catalog
+   entries that start with what has been typed so far in the output window.
+   Tab replaces the input with the first suggestion; Enter accepts it.
+ */
+void getLineWithCompletion(WINDOW *aWin, int r, int c, char buff[512],
+                           const Completer &complete) {
+  std::string line;
+  vSV suggestions;
+  noecho();
+  keypad(aWin, TRUE);
+  while (true) {
+    suggestions.clear();
+    if (!line.empty()) {
+      complete(line, suggestions);
+    }
+    werase(oWin);
+    int maxW(getmaxx(oWin) - 4);
+    if (!suggestions.empty()) {
+      mvwprintw(oWin, 2, 2, "Suggestions (Tab takes the first):");
+    }
+    int row(4);
+    for (std::string_view s : suggestions) {
+      mvwaddnstr(oWin, row++, 2, s.data(), std::min<int>(s.size(), maxW));
+    }
+    resetOWin();
+    mvwaddnstr(aWin, r, c, line.c_str(), line.size());
+    wclrtoeol(aWin);
+    resetIWin();
+    wmove(aWin, r, c + line.size());
+    wnoutrefresh(aWin);
+    {
+      TraceSpan span("doupdate");
+      doupdate();
+    }
+
+    int ch;
+    {
+      TraceSpan span("wait for key");
+      ch = wgetch(aWin);
+    }
+    if (ch == '\n' || ch == '\r' || ch == KEY_ENTER) {
+      break;
+    } else if (ch == '\t') {
+      if (!suggestions.empty()) {
+        line = std::string(suggestions.front().substr(0, 511));
+      }
+    } else if (ch == KEY_BACKSPACE || ch == 127 || ch == 8) {
+      if (!line.empty()) {
+        line.pop_back();
+      }
+    } else if (ch >= ' ' && ch < 256 && line.size() < 511) {
+      line.push_back(char(ch));
+    }
+  }
+  keypad(aWin, FALSE);
+  werase(oWin);
+  resetOWin();
+  snprintf(buff, 512, "%s", line.c_str());
+}
+
 void displayHelp() {
+  TraceSpan span(__func__);
   std::string h0("Help Screen");
   std::string h1("Choose one of the availible options from the above menu. ");
   std::string h2("e.g. 'c' will display the catalog, 'a' to add a book, etc.");
   std::string h3("To quit the program, press the 'x' key.");
-  werase(oWin);
-  werase(mWin);
-  displayMenu();
+  // tuiLoop has cleared mWin and keeps the menu in oWin
   displayStringAtCenter(mWin, h0, 1);
   displayStringAtCenter(mWin, h1, 2);
   displayStringAtCenter(mWin, h2, 3);
@@ -505,10 +971,10 @@ void displayStringAtCenter(WINDOW *aWin, std::string str, int onRow) {
     }
     mvwprintw(aWin, onRow, xPos, str.c_str());
   }
-  wrefresh(aWin);
+  wnoutrefresh(aWin);
 }
 
-void displayBook(WINDOW *aWin, Book &b, int r, int tPos, int aPos, int iPos,
+void displayBook(WINDOW *aWin, const Book &b, int r, int tPos, int aPos, int iPos,
                  int maxW) {
   std::string tt(b.getTitle());
   if (tt.size() > maxW) {
@@ -530,18 +996,36 @@ void displayBook(WINDOW *aWin, Book &b, int r, int tPos, int aPos, int iPos,
 }
 
 void displayCatalog(Library &aLibrary) {
+  TraceSpan span(__func__);
   int r(1);
   werase(oWin);
   resetOWin();
   std::string t0("Your Catalog:");
   displayStringAtCenter(oWin, t0, r);
   r += 2;
-  auto dcatalog(aLibrary.getAllBooks());
-  vBook results;
-  for (auto aPair : dcatalog) {
-    results.emplace_back(aPair.second);
-  }
-  displyBookVector(results);
+  displayCatalogPages(aLibrary);
+}
+
+/* displayCatalogPages
+   gets: Library
+   returns: nothing
+   objective: page through the whole catalog in title, author or ISBN order
+   method: the Library keeps all three orders up to date, so a key press
+   only fetches the books of the page on show; nothing is copied or sorted.
+ */
+void displayCatalogPages(Library &aLibrary) {
+  ul tw, aw, iw;
+  aLibrary.fieldWidths(tw, aw, iw);
+  CatalogOrder order(orderTitle);
+  browsePages(
+      aLibrary.size(), std::max<ul>(tw, 5) + 2, std::max<ul>(aw, 6) + 2,
+      std::max<ul>(iw, 4) + 2,
+      [&](ul first, ul count, vpBook &page) {
+        aLibrary.catalogPage(order, first, count, page);
+      },
+      [&](int ch) {
+        order = ch == 't' ? orderTitle : ch == 'a' ? orderAuthor : orderISBN;
+      });
 }
 
 /* displayMenu
@@ -550,6 +1034,7 @@ void displayCatalog(Library &aLibrary) {
    objective: display options - used by displayHelp & displayMenu
  */
 void displayMenu() {
+  TraceSpan span(__func__);
   std::string l1("Welcome to Your Library");
   std::string m0("MENU");
   std::string m1("h: Help");
@@ -557,18 +1042,26 @@ void displayMenu() {
   std::string m3("i: search by Isbn");
   std::string m4("t: search by Title");
   std::string m5("s: Search by author");
-  std::string m6("a: Add a book");
-  std::string m7("r: Remove a book");
-  std::string m8("x: eXit Library");
-  vString menuDetail({m1, m2, m3, m4, m5, m6, m7, m8});
+  std::string m6("w: search by Words");
+  std::string m7("g: Grep all fields");
+  std::string m8("a: Add a book");
+  std::string m9("m: iMport books from a file");
+  std::string m10("e: Export the catalog to a file");
+  std::string m11("r: Remove a book");
+  std::string m12("x: eXit Library");
+  vString menuDetail({m1, m2, m3, m4, m5, m6, m7, m8, m9, m10, m11, m12});
   int maxRows, maxCols;
   getmaxyx(oWin, maxRows, maxCols);
 
   displayStringAtCenter(oWin, l1, 1);
   displayStringAtCenter(oWin, m0, 3);
-  unsigned r(5), c((maxCols - maxSizeInVector(menuDetail)) >> 1);
-  for (auto s : menuDetail) {
-    mvwprintw(oWin, r++, c, s.c_str());
+  // two columns when one does not fit above the bottom border
+  int rows(maxRows - 6 < int(menuDetail.size()) ? (menuDetail.size() + 1) / 2
+                                                 : menuDetail.size());
+  int w(maxSizeInVector(menuDetail) + 4);
+  int c((maxCols - w * ((menuDetail.size() + rows - 1) / rows) + 4) >> 1);
+  for (ul i = 0; i < menuDetail.size(); i++) {
+    mvwprintw(oWin, 5 + i % rows, c + i / rows * w, menuDetail[i].c_str());
   }
 }
 
@@ -596,6 +1089,24 @@ int maxSizeInVector(vString sv) {
   return sz;
 }
 
+/* windowCells
+   gets: WINDOW pointer, vector of cells
+   returns: nothing
+   objective: copy the window's every cell, character and attributes, so a
+   later copy shows whether anything was drawn over it in between. The
+   window's cursor is left where it was.
+ */
+void windowCells(WINDOW *aWin, std::vector<chtype> &cells) {
+  int rows, cols, y, x;
+  getmaxyx(aWin, rows, cols);
+  getyx(aWin, y, x);
+  cells.resize(rows * (cols + 1)); // winchnstr ends each row with a 0
+  for (int r = 0; r < rows; r++) {
+    mvwinchnstr(aWin, r, 0, &cells[r * (cols + 1)], cols);
+  }
+  wmove(aWin, y, x);
+}
+
 /* lastColForThis
    gets: WINDOW pointer, string
    returns: int
@@ -650,97 +1161,142 @@ void catalogSizing(int &l, int &c, int &r, int &lef, int &cen, int &rig,
    method: locates the center, displays the header, traverses the vector
    displaying title, author, and ISBN using the displayBook function.
  */
-void displyBookVector(vBook &books) {
-  if (books.empty()) {
+void displyBookVector(vpBook &books) {
+  TraceSpan span(__func__);
+  int l, c, r;
+  {
+    TraceSpan widths("getMinColSizes");
+    getMinColSizes(books, l, c, r);
+  }
+  browsePages(
+      books.size(), l, c, r,
+      [&books](ul first, ul count, vpBook &page) {
+        page.assign(books.begin() + first,
+                    books.begin() + std::min(books.size(), first + count));
+      },
+      [&books](int ch) {
+        TraceSpan span("sort");
+        if (ch == 't') {
+          sortCatalogTitle(books);
+        } else if (ch == 'a') {
+          sortCatalogAuthor(books);
+        } else {
+          sortCatalogISBN(books);
+        }
+      });
+}
+
+/* browsePages
+   gets: number of books, widest title, author & ISBN columns, where the
+   books come from, how to reorder them
+   returns: nothing
+   objective: let the user page through count books
+   method: a page is only the range [cpn * per page, + per page) of what is
+   shown; source fills just that range when it is displayed, so paging,
+   jumping to a page number and resizing cost O(rows on screen). A resize
+   keeps the first book on screen in view.
+ */
+void browsePages(ul count, int l, int c, int r, const PageSource &source,
+                 const Reorder &reorder) {
+  if (count == 0) {
     return;
   }
-  int l, c, r, lef, cen, rig, maxW;
-  getMinColSizes(books, l, c, r);
-  int maxRows, maxCols;
-  getmaxyx(oWin, maxRows, maxCols);
+  int lef, cen, rig, maxW;
   catalogSizing(l, c, r, lef, cen, rig, maxW);
-  const int maxLn(maxRows - 3);
-  vvBook pages;
-  paginate(books, pages);
-  int cpn(0);  // current page number - 1 (pages index)
-  int ch('h'); // page one, for starters
+  vpBook page;
+  ul first(0);   // position of the first book on screen
+  int cpn(0);    // current page number - 1
+  int shown(-1); // page on screen, -1 when the screen needs painting
+  int ch('h');   // page one, for starters
   while (true) {
+    int pc((count + booksPerPage() - 1) / booksPerPage());
     if (ch == 'x') {
       break;
     } else if (ch == KEY_RESIZE) {
-      resizeWhileInCatalog(books, pages, cpn, ch);
+      handleResize(ch);
       catalogSizing(l, c, r, lef, cen, rig, maxW);
+      pc = (count + booksPerPage() - 1) / booksPerPage();
+      cpn = first / booksPerPage();
+      shown = -1;
     } else if (ch == 'h') { // first page
       cpn = 0;
     } else if (ch == 'j') { // next page
-      cpn = cpn < pages.size() - 1 ? cpn + 1 : 0;
+      cpn = cpn < pc - 1 ? cpn + 1 : 0;
     } else if (ch == 'k') { // prev page
-      cpn = cpn > 0 ? cpn - 1 : pages.size() - 1;
+      cpn = cpn > 0 ? cpn - 1 : pc - 1;
     } else if (ch == 'l') { // last page
-      cpn = pages.size() - 1;
-    } else if (ch == 't') { // sort using title
-      sortCatalogTitle(books, pages, cpn, maxLn);
-    } else if (ch == 'a') { // sort using author
-      sortCatalogAuthor(books, pages, cpn, maxLn);
-    } else if (ch == 'i') { // sort by isbn
-      sortCatalogISBN(books, pages, cpn, maxLn);
+      cpn = pc - 1;
+    } else if (ch >= '1' && ch <= '9') { // a page number
+      int pn(readPageNumber(ch, pc));
+      cpn = pn > 0 ? pn - 1 : cpn;
+      shown = -1; // the prompt is still in the input window
+    } else if (ch == 't' || ch == 'a' || ch == 'i') {
+      reorder(ch);
+      cpn = 0;
+      shown = -1;
     } else {
       cpn = 0;
     }
-    displayCurrentPage(pages[cpn], lef, cen, rig, cpn, maxW);
-    displayPaginationMessage(cpn, pages.size(), books.size());
-    werase(iWin);
-    // werase(mWin);
-    resetMWin();
-    resetIWin();
-    resetOWin();
-    ch = getch();
+    if (cpn != shown) { // staying on the same page leaves the screen be
+      first = ul(cpn) * booksPerPage();
+      {
+        TraceSpan span("fetch page");
+        source(first, booksPerPage(), page);
+      }
+      {
+        TraceSpan span("displayCurrentPage");
+        displayCurrentPage(page, lef, cen, rig, cpn, maxW);
+      }
+      displayPaginationMessage(cpn, pc, count);
+      werase(iWin);
+      resetMWin();
+      resetIWin();
+      resetOWin();
+      shown = cpn;
+    }
+    ch = readKey();
   }
   werase(oWin);
   werase(mWin);
 }
 
-void getMinColSizes(vBook &books, int &l, int &c, int &r) {
+/* readPageNumber
+   gets: the first digit typed, number of pages
+   returns: int
+   objective: read the rest of a page number in the input window; 0 when
+   it is not a page there is
+ */
+int readPageNumber(int ch, int pc) {
+  char buff[16] = {char(ch), 0};
+  werase(iWin);
+  resetIWin();
+  mvwprintw(iWin, 2, 9, "Go to page: %c", ch);
+  echo();
+  curs_set(1);
+  {
+    TraceSpan span("wait for key");
+    wgetnstr(iWin, buff + 1, sizeof(buff) - 2);
+  }
+  noecho();
+  curs_set(0);
+  int pn(atoi(buff));
+  return pn >= 1 && pn <= pc ? pn : 0;
+}
+
+void getMinColSizes(const vpBook &books, int &l, int &c, int &r) {
   l = 5; // "Title".size();
   c = 6; // "Author".size();
   r = 4; // "ISBN".size();
-  for (auto book : books) {
-    l = book.getTitle().size() > l ? book.getTitle().size() : l;
-    c = book.getAuthor().size() > c ? book.getAuthor().size() : c;
-    r = book.getISBN().size() > r ? book.getISBN().size() : r;
+  for (const Book *book : books) {
+    l = book->getTitleView().size() > l ? book->getTitleView().size() : l;
+    c = book->getAuthorView().size() > c ? book->getAuthorView().size() : c;
+    r = book->getISBNView().size() > r ? book->getISBNView().size() : r;
   }
   l += 2;
   c += 2;
   r += 2;
 }
 
-void sortCatalogAuthor(vBook &books, vvBook &pages, int &cpn, int maxLn) {
-  std::sort(books.begin(), books.end(),
-            [](const Book &book1, const Book &book2) {
-              return book1.getAuthor() < book2.getAuthor();
-            });
-  cpn = 0;
-  paginate(books, pages);
-}
-
-void sortCatalogTitle(vBook &books, vvBook &pages, int &cpn, int maxLn) {
-  std::sort(books.begin(), books.end(),
-            [](const Book &book1, const Book &book2) {
-              return book1.getTitle() < book2.getTitle();
-            });
-  cpn = 0;
-  paginate(books, pages);
-}
-
-void sortCatalogISBN(vBook &books, vvBook &pages, int &cpn, int maxLn) {
-  std::sort(books.begin(), books.end(),
-            [](const Book &book1, const Book &book2) {
-              return book1.getISBN() < book2.getISBN();
-            });
-  cpn = 0;
-  paginate(books, pages);
-}
-
 void displayPaginationMessage(int cpn, int pc, int bc) {
   werase(mWin);
   std::string bp(bc == 1 ? "book" : "books");
@@ -750,7 +1306,8 @@ void displayPaginationMessage(int cpn, int pc, int bc) {
   std::string h0(tmp);
   std::string h1("Sort options: 't' Title, 'a' Author, and 'i' Isbn ");
   std::string h2("Press 'h' for first, 'j' for next page, 'k' for previous, "
-                 "'l' for last, and 'x' to get back to the main screen.");
+                 "'l' for last, a page number to jump to it, and 'x' to get "
+                 "back to the main screen.");
   displayStringAtCenter(mWin, h0, 1);
   if (bc > 1) {
     displayStringAtCenter(mWin, h1, 2);
@@ -771,78 +1328,82 @@ void displayHeader(WINDOW *aWin, int r, int lef, int cen, int rig, int cpn) {
   }
 }
 
-/*
- segment a collection of books into a collection of pages. Each page is a
- collection of books of a number that won't overfill the window.
-*/
-void paginate(const vBook &books, vvBook &pages) {
+// how many books fit on a page of the output window
+ul booksPerPage() {
   int maxLn(getmaxy(oWin) - 5);
   maxLn = maxLn < 1 ? 1 : maxLn;
-
-  pages.clear();
-  vBook t0;
-  t0.clear();
-  pages.emplace_back(t0);
-  for (auto b : books) {
-    if (pages.back().size() > maxLn) {
-      vBook tn;
-      pages.emplace_back(tn);
-    }
-    pages.back().emplace_back(b);
-  }
+  return maxLn + 1;
 }
 
 // cpn: current page number
 // flo: firsrt line out
-void displayCurrentPage(vBook books, int lef, int cen, int rig, int cpn,
+void displayCurrentPage(const vpBook &books, int lef, int cen, int rig, int cpn,
                         int maxW) {
   werase(oWin);
   displayHeader(oWin, 2, lef, cen, rig, cpn);
   int r(5); // leave room for top matter
-  for (auto aBook : books) {
-    displayBook(oWin, aBook, r++, lef, cen, rig, maxW);
+  for (const Book *aBook : books) {
+    displayBook(oWin, *aBook, r++, lef, cen, rig, maxW);
   }
-  wrefresh(oWin);
+  wnoutrefresh(oWin);
 }
 
 void resetOWin() {
   box(oWin, 0, 0);
   mvwprintw(oWin, 0, lastColForThis(oWin, "Output") - 2, "Output");
-  wrefresh(oWin);
+  wnoutrefresh(oWin);
 }
 
 void resetMWin() {
   box(mWin, 0, 0);
   mvwprintw(mWin, 0, lastColForThis(mWin, "Messages") - 2, "Messages");
-  wrefresh(mWin);
+  wnoutrefresh(mWin);
 }
 
 void resetIWin() {
   box(iWin, 0, 0);
   mvwprintw(iWin, 0, lastColForThis(iWin, "Input") - 2, "Input");
-  wrefresh(iWin);
+  wnoutrefresh(iWin);
 }
 
 int midRowInWin(WINDOW *aWin) { return getmaxy(aWin) >> 1; }
 
 int midColInWin(WINDOW *aWin) { return getmaxx(aWin) >> 1; }
 
+/* displayWindowSizes
+   gets: nothing
+   returns: nothing
+   objective: the hidden debug screen: each window's size, and the call
+   counts and latencies of every operation so far (see metrics.hpp),
+   redrawn each second until a key is pressed
+ */
 void displayWindowSizes() {
-  int sW, sH;
-  werase(oWin);
-  werase(mWin);
-  werase(iWin);
-  getmaxyx(oWin, sH, sW);
-  int xPos((sW >> 1) - 8);
-  mvwprintw(oWin, sH >> 1, xPos, "ROWS: %d COLS: %d", sH, sW);
-  getmaxyx(mWin, sH, sW);
-  mvwprintw(mWin, sH >> 1, xPos, "ROWS: %d COLS: %d", sH, sW);
-  getmaxyx(iWin, sH, sW);
-  mvwprintw(iWin, sH >> 1, xPos, "ROWS: %d COLS: %d", sH, sW);
-  resetIWin();
-  resetMWin();
-  resetOWin();
-  getch();
+  TraceSpan span(__func__);
+  vString lines;
+  int ch(ERR);
+  timeout(1000);
+  do {
+    int sW, sH;
+    werase(oWin);
+    werase(mWin);
+    werase(iWin);
+    getmaxyx(oWin, sH, sW);
+    int xPos((sW >> 1) - 8);
+    mvwprintw(oWin, 1, xPos, "ROWS: %d COLS: %d", sH, sW);
+    metricsTable(lines);
+    for (ul i = 0; i < lines.size() && int(i) + 4 < sH; i++) {
+      mvwaddnstr(oWin, int(i) + 3, 2, lines[i].c_str(), sW - 4);
+    }
+    getmaxyx(mWin, sH, sW);
+    mvwprintw(mWin, sH >> 1, xPos, "ROWS: %d COLS: %d", sH, sW);
+    getmaxyx(iWin, sH, sW);
+    mvwprintw(iWin, sH >> 1, xPos, "ROWS: %d COLS: %d", sH, sW);
+    resetIWin();
+    resetMWin();
+    resetOWin();
+    ch = readKey();
+  } while (ch == ERR);
+  timeout(-1);
   werase(oWin);
   werase(mWin);
   werase(iWin);
@@ -851,15 +1412,8 @@ void displayWindowSizes() {
   resetOWin();
 }
 
-void resizeWhileInCatalog(vBook &books, vvBook &pages, int &cpn, int ch) {
-  handleResize(ch);
-  paginate(books, pages);
-  cpn = 0;
-  displayPaginationMessage(cpn, books.size(), pages.size());
-}
-
 void displayBookPrompt(WINDOW *aWin) {
-  wclear(aWin);
+  werase(aWin);
   mvwprintw(aWin, 1, 2, "Title: ");
   mvwprintw(aWin, 2, 1, "Author: ");
   mvwprintw(aWin, 3, 3, "ISBN: ");
@@ -872,7 +1426,7 @@ void getBookData(WINDOW *aWin, Book &aBook) {
   resetIWin();
   mvwprintw(aWin, 0, 9, "Please enter the title below.");
   mvwprintw(aWin, 1, 2, "Title: ");
-  wrefresh(aWin);
+  wnoutrefresh(aWin);
   wmove(aWin, 1, 9);
   echo();
   wgetstr(aWin, buff); // Use wgetstr instead of getstr
@@ -881,7 +1435,7 @@ void getBookData(WINDOW *aWin, Book &aBook) {
   resetIWin();
   mvwprintw(aWin, 0, 9, "Please enter the author below.");
   mvwprintw(aWin, 2, 1, "Author: ");
-  wrefresh(aWin);
+  wnoutrefresh(aWin);
   wmove(aWin, 2, 9);
   echo();
   wgetstr(aWin, buff); // Use wgetstr instead of getstr
@@ -890,20 +1444,20 @@ void getBookData(WINDOW *aWin, Book &aBook) {
   resetIWin();
   mvwprintw(aWin, 0, 9, "Please enter the ISBN below.");
   mvwprintw(aWin, 3, 3, "ISBN: ");
-  wrefresh(aWin);
+  wnoutrefresh(aWin);
   wmove(aWin, 3, 9);
   echo();
   wgetstr(aWin, buff); // Use wgetstr instead of getstr
   aBook.setISBN(buff);
 
-  wclear(aWin);
+  werase(aWin);
   resetIWin();
   curs_set(0);
   noecho();
   displayOneBook(aBook);
 }
 
-void displayOneBook(Book &aBook) {
+void displayOneBook(const Book &aBook) {
   displayBookPrompt(mWin);
   mvwprintw(mWin, 1, 9, aBook.getTitle().c_str());
   mvwprintw(mWin, 2, 9, aBook.getAuthor().c_str());
@@ -0,0 +1,126 @@
+// metrics.cpp
+
+#include "metrics.hpp"
+#include "lms_project.hpp"
+
+namespace {
+
+Metric metrics[metricCount];
+
+const char *names[metricCount] = {
+    "add",          "remove",        "search title",  "search author",
+    "search isbn",  "search words",  "title prefix",  "author prefix",
+    "similar",      "scan",          "complete",      "page",
+    "serialize",    "deserialize",   "checkpoint",    "import",
+    "export",       "frame"};
+
+// 0 .. 7 as they are, then eight buckets per power of two
+ul bucketFor(ul ns) {
+  if (ns < 8) {
+    return ns;
+  }
+  int e(63 - __builtin_clzl(ns)); // 2^e <= ns < 2^(e + 1), e >= 3
+  ul index((e - 2) * 8 + ((ns >> (e - 3)) & 7));
+  return std::min<ul>(index, Metric::bucketCount - 1);
+}
+
+// the largest duration that lands in bucket i
+ul bucketTop(ul i) {
+  if (i < 8) {
+    return i;
+  }
+  int e(i / 8 + 2);
+  return ((8 + i % 8 + 1) << (e - 3)) - 1;
+}
+
+// ns as a short human reading: 850ns, 12.3us, 4.1ms, 1.20s
+std::string formatNanos(double ns) {
+  char buff[32];
+  if (ns < 1000) {
+    snprintf(buff, sizeof(buff), "%.0fns", ns);
+  } else if (ns < 1e6) {
+    snprintf(buff, sizeof(buff), "%.1fus", ns / 1e3);
+  } else if (ns < 1e9) {
+    snprintf(buff, sizeof(buff), "%.1fms", ns / 1e6);
+  } else {
+    snprintf(buff, sizeof(buff), "%.2fs", ns / 1e9);
+  }
+  return buff;
+}
+
+} // namespace
+
+void Metric::record(ul ns) {
+  buckets[bucketFor(ns)].fetch_add(1, std::memory_order_relaxed);
+  count.fetch_add(1, std::memory_order_relaxed);
+  total.fetch_add(ns, std::memory_order_relaxed);
+  ul seen(maximum.load(std::memory_order_relaxed));
+  while (ns > seen &&
+         !maximum.compare_exchange_weak(seen, ns, std::memory_order_relaxed)) {
+  }
+}
+
+/*
+ the duration p (0 .. 1) of the calls took at most, to within a bucket.
+ Read while others record, the counts may be a call or two apart; the
+ walk stops at the last bucket rather than run off the end.
+ */
+ul Metric::percentile(double p) const {
+  ul n(calls());
+  if (n == 0) {
+    return 0;
+  }
+  ul wanted(std::max<ul>(1, std::ceil(p * n)));
+  ul seen(0);
+  for (ul i = 0; i < bucketCount; i++) {
+    seen += buckets[i].load(std::memory_order_relaxed);
+    if (seen >= wanted) {
+      return std::min(bucketTop(i), longest());
+    }
+  }
+  return longest();
+}
+
+double Metric::mean() const {
+  ul n(calls());
+  return n ? double(total.load(std::memory_order_relaxed)) / n : 0;
+}
+
+Metric &metric(MetricKind kind) { return metrics[kind]; }
+
+const char *metricName(MetricKind kind) { return names[kind]; }
+
+void metricsTable(vString &lines) {
+  lines.clear();
+  char buff[128];
+  snprintf(buff, sizeof(buff), "%-14s %9s %8s %8s %8s %8s %8s", "operation",
+           "calls", "mean", "p50", "p90", "p99", "max");
+  lines.emplace_back(buff);
+  for (int k = 0; k < metricCount; k++) {
+    const Metric &m(metric(MetricKind(k)));
+    if (m.calls() == 0) {
+      continue;
+    }
+    snprintf(buff, sizeof(buff), "%-14s %9lu %8s %8s %8s %8s %8s",
+             names[k], m.calls(), formatNanos(m.mean()).c_str(),
+             formatNanos(m.percentile(0.5)).c_str(),
+             formatNanos(m.percentile(0.9)).c_str(),
+             formatNanos(m.percentile(0.99)).c_str(),
+             formatNanos(m.longest()).c_str());
+    lines.emplace_back(buff);
+  }
+}
+
+bool saveMetrics() {
+  const char *path(std::getenv("LMS_METRICS"));
+  if (!path || !*path) {
+    return true;
+  }
+  std::ofstream out(path);
+  vString lines;
+  metricsTable(lines);
+  for (const std::string &line : lines) {
+    out << line << '\n';
+  }
+  return bool(out);
+}
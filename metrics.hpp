@@ -0,0 +1,88 @@
+// metrics.hpp
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include "trace.hpp"
+#include "lms_project.hpp"
+
+/*
+ Call counts and latency histograms for the catalog's operations, cheap
+ enough to leave on: the 'D' screen shows them, and they are written to
+ the file named by $LMS_METRICS when lms exits.
+
+ Durations go into log-linear buckets, HDR style: eight per power of two
+ of nanoseconds, so a percentile read back is within 12.5% of the true
+ value anywhere from a nanosecond to minutes. Recording is two clock reads
+ and a few relaxed atomic adds: no lock, no allocation, any thread.
+
+ Time a scope with MetricTimer timer(metricSearchTitle);
+ */
+enum MetricKind {
+  metricAdd,
+  metricRemove,
+  metricSearchTitle,
+  metricSearchAuthor,
+  metricSearchISBN,
+  metricSearchWords,
+  metricSearchTitlePrefix,
+  metricSearchAuthorPrefix,
+  metricFuzzyAuthors,
+  metricScan,
+  metricComplete,
+  metricPage,
+  metricSerialize,
+  metricDeserialize,
+  metricCheckpoint,
+  metricImport,
+  metricExport,
+  metricFrame, // TUI: from a key arriving to its frame being on screen
+  metricCount
+};
+
+class Metric {
+public:
+  static const ul bucketCount = 8 * 40; // up to 2^42 ns, over an hour
+
+  void record(ul ns);
+  ul calls() const { return count.load(std::memory_order_relaxed); }
+  ul percentile(double p) const; // ns; 0 before the first call
+  ul longest() const { return maximum.load(std::memory_order_relaxed); }
+  double mean() const; // ns
+
+private:
+  std::atomic<ul> buckets[bucketCount] = {};
+  std::atomic<ul> count{0};
+  std::atomic<ul> total{0}; // ns
+  std::atomic<ul> maximum{0};
+};
+
+Metric &metric(MetricKind kind);
+const char *metricName(MetricKind kind);
+
+class MetricTimer {
+public:
+  explicit MetricTimer(MetricKind kind)
+      : kind(kind), started(std::chrono::steady_clock::now()) {}
+  MetricTimer(const MetricTimer &) = delete;
+  MetricTimer &operator=(const MetricTimer &) = delete;
+  ~MetricTimer() { // also a trace span when tracing, see trace.hpp
+    auto ended(std::chrono::steady_clock::now());
+    metric(kind).record(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(ended - started)
+            .count());
+    if (tracing()) {
+      traceSpan(metricName(kind), started, ended);
+    }
+  }
+
+private:
+  MetricKind kind;
+  std::chrono::steady_clock::time_point started;
+};
+
+// a header and one line per operation called so far, for screen or file
+void metricsTable(vString &lines);
+// writes metricsTable to $LMS_METRICS if set; false if that failed
+bool saveMetrics();
+
+#endif // METRICS_HPP
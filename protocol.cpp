@@ -0,0 +1,89 @@
+// protocol.cpp
+
+#include "protocol.hpp"
+#include "lms_project.hpp"
+
+namespace {
+
+void putU32(std::string &out, uint32_t v) {
+  out.append(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+uint32_t getU32(const char *p) {
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+} // namespace
+
+ul messageLength(const vSV &fields) {
+  ul length(1 + sizeof(uint32_t));
+  for (std::string_view f : fields) {
+    length += sizeof(uint32_t) + f.size();
+  }
+  return length;
+}
+
+void encodeMessage(uint8_t code, const vSV &fields,
+                   std::string &out) {
+  ul length(messageLength(fields));
+  out.reserve(out.size() + sizeof(uint32_t) + length);
+  putU32(out, length);
+  out.push_back(char(code));
+  putU32(out, fields.size());
+  for (std::string_view f : fields) {
+    putU32(out, f.size());
+    out.append(f);
+  }
+}
+
+bool decodeMessage(std::string_view in, Message &message, ul &used) {
+  used = 0;
+  if (in.size() < sizeof(uint32_t)) {
+    return true;
+  }
+  ul length(getU32(in.data()));
+  if (length < 1 + sizeof(uint32_t) || length > maxMessage) {
+    return false;
+  }
+  if (in.size() < sizeof(uint32_t) + length) {
+    return true; // the rest is still on its way
+  }
+  std::string_view body(in.substr(sizeof(uint32_t), length));
+  message.code = uint8_t(body[0]);
+  ul count(getU32(body.data() + 1));
+  body.remove_prefix(1 + sizeof(uint32_t));
+  message.fields.clear();
+  for (ul i = 0; i < count; i++) {
+    if (body.size() < sizeof(uint32_t)) {
+      return false;
+    }
+    ul size(getU32(body.data()));
+    body.remove_prefix(sizeof(uint32_t));
+    if (size > body.size()) {
+      return false;
+    }
+    message.fields.push_back(body.substr(0, size));
+    body.remove_prefix(size);
+  }
+  if (!body.empty()) {
+    return false;
+  }
+  used = sizeof(uint32_t) + length;
+  return true;
+}
+
+bool fieldNumber(std::string_view field, ul &n) {
+  n = 0;
+  if (field.empty() || field.size() > 19) {
+    return false;
+  }
+  for (char ch : field) {
+    if (ch < '0' || ch > '9') {
+      return false;
+    }
+    n = n * 10 + (ch - '0');
+  }
+  return true;
+}
@@ -0,0 +1,85 @@
+// protocol.hpp
+#ifndef PROTOCOL_HPP
+#define PROTOCOL_HPP
+
+#include "lms_project.hpp"
+
+/*
+ Wire format between lms serve and its clients (see server.hpp and
+ client.hpp). Requests and replies alike are
+
+   uint32_t length   bytes that follow
+   uint8_t  code     a Request, or a Status in a reply
+   uint32_t count    number of fields
+   fields            each uint32_t size + bytes
+
+ in host byte order, both ends being on one machine. Numbers travel as
+ decimal text. Replies list books as three fields each (title, author,
+ isbn) and anything else as one field per item. A client may send
+ requests back to back without waiting; replies come back in order.
+ A reply that would pass maxMessage is not sent: statusTooLarge comes
+ back instead, with no fields, and the client may ask for fewer.
+
+   request           fields                      reply fields
+   reqSize           -                           book count
+   reqTitle          title                       books
+   reqAuthor         author                      books
+   reqISBN           isbn                        books
+   reqWords          query                       books
+   reqTitlePrefix    prefix, k                   books
+   reqAuthorPrefix   prefix, k                   books
+   reqSimilar        author, maxDistance, k      authors
+   reqCompleteTitle  prefix, k                   titles
+   reqCompleteAuthor prefix, k                   authors
+   reqPage           order, first, count         books (see CatalogOrder)
+   reqWidths         -                           widest title, author, isbn
+   reqAdd            title, author, isbn         -
+   reqRemove         isbn                        -
+ */
+enum Request : uint8_t {
+  reqSize = 1,
+  reqTitle,
+  reqAuthor,
+  reqISBN,
+  reqWords,
+  reqTitlePrefix,
+  reqAuthorPrefix,
+  reqSimilar,
+  reqCompleteTitle,
+  reqCompleteAuthor,
+  reqPage,
+  reqWidths,
+  reqAdd,
+  reqRemove
+};
+
+enum Status : uint8_t {
+  statusOK = 0,
+  statusRefused = 1,
+  statusBadRequest = 2,
+  statusTooLarge = 3
+};
+
+const ul maxMessage = 64 << 20; // longer messages are treated as garbage
+const char defaultSocketPath[] = "library_data.sock";
+
+// a decoded message; the fields are views into the bytes it came from
+struct Message {
+  uint8_t code = 0;
+  vSV fields;
+};
+
+void encodeMessage(uint8_t code, const vSV &fields,
+                   std::string &out);
+// the length a message with these fields declares (see above)
+ul messageLength(const vSV &fields);
+/*
+ decodes the message at the front of in. used is its size, or 0 when in
+ does not hold all of it yet; false when it cannot be a message.
+ */
+bool decodeMessage(std::string_view in, Message &message, ul &used);
+
+// a field holding a number; false if it does not
+bool fieldNumber(std::string_view field, ul &n);
+
+#endif // PROTOCOL_HPP
@@ -0,0 +1,641 @@
+// server.cpp
+
+#include "server.hpp"
+#include "concurrent_library.hpp"
+#include "library.hpp"
+#include "protocol.hpp"
+#include "thread_pool.hpp"
+#include "lms_project.hpp"
+
+namespace {
+
+const ul readBudget(1 << 20); // most bytes taken from one client per pass
+const ul backlogLimit(8 << 20); // stop reading while this much is unsent
+
+volatile sig_atomic_t stopRequested = 0;
+
+void requestStop(int) { stopRequested = 1; }
+
+bool setNonBlocking(int fd) {
+  int flags(fcntl(fd, F_GETFL));
+  return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+struct Connection {
+  std::string in; // bytes received; from inUsed on not yet answered
+  ul inUsed = 0;
+  std::string out; // replies; from outUsed on not yet written
+  ul outUsed = 0;
+  bool reading = true;  // what the poller is asked to wait for
+  bool writing = false;
+  bool closing = false; // hung up or sent garbage: close once out is sent
+  bool editing = false; // an edit is with the Writer: what follows waits in in
+};
+
+struct Pending {
+  int fd;
+  Message request;
+  std::string reply;
+};
+
+// edits for the Writer, and the client each came from
+struct EditBatch {
+  std::vector<int> fds;
+  std::vector<BookEdit> edits;
+};
+
+/*
+ the thread that applies edits while the loop thread answers lookups.
+ Each batch is applied, then checkpointed, then handed back through done,
+ and a byte written to wakeFd so the loop thread's wait ends.
+ */
+class Writer {
+public:
+  Writer(ConcurrentLibrary &shared, int wakeFd);
+  Writer(const Writer &) = delete;
+  Writer &operator=(const Writer &) = delete;
+  ~Writer() { stop(); }
+  void submit(EditBatch &batch); // takes the edits, leaving batch empty
+  void takeDone(EditBatch &batch);
+  void stop(); // once the edits submitted are applied
+
+private:
+  void work();
+
+  ConcurrentLibrary &shared;
+  int wakeFd;
+  std::mutex lock; // guards what follows
+  std::condition_variable wake;
+  EditBatch queued;
+  EditBatch done;
+  bool stopping = false;
+  std::thread thread;
+};
+
+Writer::Writer(ConcurrentLibrary &shared, int wakeFd)
+    : shared(shared), wakeFd(wakeFd) {
+  // SIGINT and SIGTERM must reach the loop thread, to end its wait
+  sigset_t blocked, old;
+  sigemptyset(&blocked);
+  sigaddset(&blocked, SIGINT);
+  sigaddset(&blocked, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &blocked, &old);
+  thread = std::thread(&Writer::work, this);
+  pthread_sigmask(SIG_SETMASK, &old, nullptr);
+}
+
+void Writer::submit(EditBatch &batch) {
+  if (batch.edits.empty()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    for (ul i = 0; i < batch.edits.size(); i++) {
+      queued.fds.push_back(batch.fds[i]);
+      queued.edits.push_back(std::move(batch.edits[i]));
+    }
+  }
+  batch.fds.clear();
+  batch.edits.clear();
+  wake.notify_one();
+}
+
+void Writer::takeDone(EditBatch &batch) {
+  std::lock_guard<std::mutex> guard(lock);
+  std::swap(batch, done);
+}
+
+void Writer::stop() {
+  if (!thread.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    stopping = true;
+  }
+  wake.notify_one();
+  thread.join();
+}
+
+void Writer::work() {
+  EditBatch batch;
+  std::unique_lock<std::mutex> guard(lock);
+  while (true) {
+    wake.wait(guard, [this] { return stopping || !queued.edits.empty(); });
+    if (queued.edits.empty()) {
+      return; // stopping, and nothing is left to apply
+    }
+    std::swap(batch, queued);
+    guard.unlock();
+    shared.apply(batch.edits);
+    // the replies go once the edits are synced, as they did before
+    shared.checkpoint();
+    guard.lock();
+    for (ul i = 0; i < batch.edits.size(); i++) {
+      done.fds.push_back(batch.fds[i]);
+      done.edits.push_back(std::move(batch.edits[i]));
+    }
+    batch.fds.clear();
+    batch.edits.clear();
+    guard.unlock();
+    char byte(0);
+    while (write(wakeFd, &byte, 1) < 0 && errno == EINTR) {
+    }
+    guard.lock();
+  }
+}
+
+// the sockets ready to read or write: epoll where there is one, else poll
+class Poller {
+public:
+  Poller() = default;
+  Poller(const Poller &) = delete;
+  Poller &operator=(const Poller &) = delete;
+  ~Poller();
+  bool open();
+  void watch(int fd, bool reading, bool writing); // add or change
+  void forget(int fd);
+  bool wait(std::vector<int> &ready); // false on failure, not on a signal
+
+private:
+#ifdef __linux__
+  int epfd = -1;
+#else
+  std::unordered_map<int, short> watched; // fd -> poll events
+#endif
+};
+
+#ifdef __linux__
+
+Poller::~Poller() {
+  if (epfd >= 0) {
+    ::close(epfd);
+  }
+}
+
+bool Poller::open() {
+  epfd = epoll_create1(EPOLL_CLOEXEC);
+  return epfd >= 0;
+}
+
+void Poller::watch(int fd, bool reading, bool writing) {
+  epoll_event event{};
+  event.events = (reading ? uint32_t(EPOLLIN) : 0u) |
+                 (writing ? uint32_t(EPOLLOUT) : 0u);
+  event.data.fd = fd;
+  if (epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &event) != 0 && errno == ENOENT) {
+    epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &event);
+  }
+}
+
+void Poller::forget(int fd) { epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr); }
+
+bool Poller::wait(std::vector<int> &ready) {
+  epoll_event events[256];
+  int n(epoll_wait(epfd, events, 256, -1));
+  if (n < 0) {
+    return errno == EINTR;
+  }
+  for (int i = 0; i < n; i++) {
+    ready.push_back(events[i].data.fd);
+  }
+  return true;
+}
+
+#else
+
+Poller::~Poller() {}
+
+bool Poller::open() { return true; }
+
+void Poller::watch(int fd, bool reading, bool writing) {
+  watched[fd] = (reading ? POLLIN : 0) | (writing ? POLLOUT : 0);
+}
+
+void Poller::forget(int fd) { watched.erase(fd); }
+
+bool Poller::wait(std::vector<int> &ready) {
+  std::vector<pollfd> fds;
+  fds.reserve(watched.size());
+  for (const auto &w : watched) {
+    fds.push_back({w.first, w.second, 0});
+  }
+  if (poll(fds.data(), fds.size(), -1) < 0) {
+    return errno == EINTR;
+  }
+  for (const pollfd &p : fds) {
+    if (p.revents != 0) {
+      ready.push_back(p.fd);
+    }
+  }
+  return true;
+}
+
+#endif
+
+// a listening socket at path, or -1; refuses to take over a live server's
+int listenOn(const std::string &path) {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    return -1;
+  }
+  std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+  int fd(socket(AF_UNIX, SOCK_STREAM, 0));
+  if (fd < 0) {
+    return -1;
+  }
+  if (connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) ==
+      0) {
+    ::close(fd); // somebody is answering there already
+    return -1;
+  }
+  ::close(fd);
+  unlink(path.c_str()); // left behind by a server that did not stop cleanly
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 ||
+      bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) !=
+          0 ||
+      listen(fd, SOMAXCONN) != 0 || !setNonBlocking(fd)) {
+    if (fd >= 0) {
+      ::close(fd);
+    }
+    return -1;
+  }
+  return fd;
+}
+
+void acceptClients(int listener, Poller &poller,
+                   std::unordered_map<int, Connection> &clients) {
+  for (;;) {
+    int fd(accept(listener, nullptr, nullptr));
+    if (fd < 0) {
+      return; // EAGAIN: nobody else is waiting
+    }
+    if (!setNonBlocking(fd)) {
+      ::close(fd);
+      continue;
+    }
+    clients.try_emplace(fd);
+    poller.watch(fd, true, false);
+  }
+}
+
+// reads what fd has for us, up to readBudget
+void readFrom(int fd, Connection &c) {
+  char buffer[64 * 1024];
+  ul taken(0);
+  while (!c.closing && taken < readBudget) {
+    ssize_t n(::read(fd, buffer, sizeof(buffer)));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return;
+    }
+    if (n <= 0) {
+      c.closing = true; // hung up; what it sent is still answered
+      return;
+    }
+    c.in.append(buffer, n);
+    taken += n;
+  }
+}
+
+// writes as much of the queued replies as the socket takes
+void writeTo(int fd, Connection &c) {
+  while (c.outUsed < c.out.size()) {
+    ssize_t n(::write(fd, c.out.data() + c.outUsed, c.out.size() - c.outUsed));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return;
+    }
+    if (n <= 0) {
+      c.closing = true; // nobody is listening: drop the rest
+      break;
+    }
+    c.outUsed += n;
+  }
+  c.out.clear();
+  c.outUsed = 0;
+}
+
+// adds and removes with the right fields; lookup refuses malformed ones
+bool isEdit(const Message &request) {
+  return (request.code == reqAdd && request.fields.size() == 3) ||
+         (request.code == reqRemove && request.fields.size() == 1);
+}
+
+/*
+ cuts the complete requests off the front of c.in, stopping after an edit:
+ the rest wait there until the Writer is done with it
+ */
+void takeRequests(int fd, Connection &c, std::vector<Pending> &pending) {
+  while (!c.editing) {
+    Message request;
+    ul used;
+    if (!decodeMessage(std::string_view(c.in).substr(c.inUsed), request,
+                       used)) {
+      c.closing = true; // lost track of where messages start
+      c.inUsed = c.in.size();
+      return;
+    }
+    if (used == 0) {
+      return;
+    }
+    c.inUsed += used;
+    c.editing = isEdit(request);
+    pending.push_back({fd, std::move(request), std::string()});
+  }
+}
+
+// the client would take a longer message for garbage and hang up
+void replyFields(const vSV &fields, std::string &reply) {
+  if (messageLength(fields) > maxMessage) {
+    encodeMessage(statusTooLarge, {}, reply);
+    return;
+  }
+  encodeMessage(statusOK, fields, reply);
+}
+
+void replyBooks(const vpBook &books, std::string &reply) {
+  vSV fields;
+  fields.reserve(3 * books.size());
+  for (const Book *b : books) {
+    fields.push_back(b->getTitleView());
+    fields.push_back(b->getAuthorView());
+    fields.push_back(b->getISBNView());
+  }
+  replyFields(fields, reply);
+}
+
+// answers a request that does not change the catalog; safe to run in parallel
+void lookup(const Library &aLibrary, const Message &request,
+            std::string &reply) {
+  const vSV &f(request.fields);
+  vpBook books;
+  vSV names;
+  ul k, distance, order, first;
+  switch (request.code) {
+  case reqSize:
+    if (f.empty()) {
+      std::string n(std::to_string(aLibrary.size()));
+      encodeMessage(statusOK, {n}, reply);
+      return;
+    }
+    break;
+  case reqWidths:
+    if (f.empty()) {
+      ul title, author, isbn;
+      aLibrary.fieldWidths(title, author, isbn);
+      std::string t(std::to_string(title)), a(std::to_string(author)),
+          i(std::to_string(isbn));
+      encodeMessage(statusOK, {t, a, i}, reply);
+      return;
+    }
+    break;
+  case reqTitle:
+  case reqAuthor:
+  case reqISBN:
+  case reqWords:
+    if (f.size() == 1) {
+      if (request.code == reqTitle) {
+        aLibrary.searchByTitle(f[0], books);
+      } else if (request.code == reqAuthor) {
+        aLibrary.searchByAuthor(f[0], books);
+      } else if (request.code == reqISBN) {
+        aLibrary.searchByISBN(f[0], books);
+      } else {
+        aLibrary.searchByWords(f[0], books);
+      }
+      replyBooks(books, reply);
+      return;
+    }
+    break;
+  case reqTitlePrefix:
+  case reqAuthorPrefix:
+    if (f.size() == 2 && fieldNumber(f[1], k)) {
+      if (request.code == reqTitlePrefix) {
+        aLibrary.searchByTitlePrefix(f[0], k, books);
+      } else {
+        aLibrary.searchByAuthorPrefix(f[0], k, books);
+      }
+      replyBooks(books, reply);
+      return;
+    }
+    break;
+  case reqSimilar:
+    if (f.size() == 3 && fieldNumber(f[1], distance) && fieldNumber(f[2], k)) {
+      aLibrary.fuzzyAuthors(f[0], distance, k, names);
+      replyFields(names, reply);
+      return;
+    }
+    break;
+  case reqCompleteTitle:
+  case reqCompleteAuthor:
+    if (f.size() == 2 && fieldNumber(f[1], k)) {
+      if (request.code == reqCompleteTitle) {
+        aLibrary.completeTitle(f[0], k, names);
+      } else {
+        aLibrary.completeAuthor(f[0], k, names);
+      }
+      replyFields(names, reply);
+      return;
+    }
+    break;
+  case reqPage:
+    if (f.size() == 3 && fieldNumber(f[0], order) && order < orderCount &&
+        fieldNumber(f[1], first) && fieldNumber(f[2], k)) {
+      aLibrary.catalogPage(CatalogOrder(order), first, k, books);
+      replyBooks(books, reply);
+      return;
+    }
+    break;
+  }
+  encodeMessage(statusBadRequest, {}, reply);
+}
+
+BookEdit editFor(const Message &request) {
+  const vSV &f(request.fields);
+  BookEdit e;
+  e.remove = request.code == reqRemove;
+  if (e.remove) {
+    e.isbn = f[0];
+  } else {
+    e.title = f[0];
+    e.author = f[1];
+    e.isbn = f[2];
+  }
+  return e;
+}
+
+/*
+ hands this pass's edits to the Writer, then answers the lookups while it
+ applies them, spread over the worker pool unless parallel is false
+ */
+void answerAll(ConcurrentLibrary &shared, bool parallel, Writer &writer,
+               std::vector<Pending> &pending) {
+  EditBatch batch;
+  std::vector<Pending *> lookups;
+  for (Pending &p : pending) {
+    if (isEdit(p.request)) {
+      batch.fds.push_back(p.fd);
+      batch.edits.push_back(editFor(p.request));
+    } else {
+      lookups.push_back(&p);
+    }
+  }
+  writer.submit(batch);
+
+  auto answer = [&shared](Pending &p) {
+    shared.read([&p](const Library &aLibrary) {
+      lookup(aLibrary, p.request, p.reply);
+    });
+  };
+  ThreadPool &pool(workerPool());
+  ul n(lookups.size());
+  if (!parallel || n == 1 || pool.size() == 1) {
+    for (Pending *p : lookups) {
+      answer(*p);
+    }
+    return;
+  }
+  ul tasks(std::min(n, pool.size() * 4));
+  pool.run(tasks, [&](ul t) {
+    for (ul r = n * t / tasks; r < n * (t + 1) / tasks; r++) {
+      answer(*lookups[r]);
+    }
+  });
+}
+
+/*
+ replies to the edits the Writer has finished, and takes the requests
+ their clients sent after them. fds lists the clients replied to.
+ */
+void takeEdited(int wakeFd, Writer &writer,
+                std::unordered_map<int, Connection> &clients,
+                std::vector<Pending> &pending, std::vector<int> &fds) {
+  char drain[256];
+  while (read(wakeFd, drain, sizeof(drain)) > 0) {
+  }
+  EditBatch batch;
+  writer.takeDone(batch);
+  for (ul i = 0; i < batch.edits.size(); i++) {
+    int fd(batch.fds[i]);
+    auto it = clients.find(fd); // kept until the reply, see serve
+    if (it == clients.end()) {
+      continue;
+    }
+    Connection &c(it->second);
+    encodeMessage(batch.edits[i].done ? statusOK : statusRefused, {}, c.out);
+    c.editing = false;
+    takeRequests(fd, c, pending);
+    fds.push_back(fd);
+  }
+}
+
+} // namespace
+
+bool serve(Library &aLibrary, const std::string &socketPath) {
+  int listener(listenOn(socketPath));
+  int wake[2] = {-1, -1}; // the Writer's end, then ours
+  Poller poller;
+  if (listener < 0 || pipe(wake) != 0 || !setNonBlocking(wake[0]) ||
+      !setNonBlocking(wake[1]) || !poller.open()) {
+    for (int fd : {listener, wake[0], wake[1]}) {
+      if (fd >= 0) {
+        ::close(fd);
+      }
+    }
+    return false;
+  }
+  poller.watch(listener, true, false);
+  poller.watch(wake[0], true, false);
+
+  struct sigaction stop{};
+  stop.sa_handler = requestStop; // no SA_RESTART: the wait must end
+  sigemptyset(&stop.sa_mask);
+  sigaction(SIGINT, &stop, nullptr);
+  sigaction(SIGTERM, &stop, nullptr);
+  signal(SIGPIPE, SIG_IGN); // a vanished client shows up as a write error
+
+  ConcurrentLibrary shared(aLibrary);
+  Writer writer(shared, wake[1]);
+  std::unordered_map<int, Connection> clients;
+  std::vector<int> ready, edited;
+  std::vector<Pending> pending;
+  while (!stopRequested) {
+    ready.clear();
+    if (!poller.wait(ready)) {
+      break;
+    }
+    pending.clear();
+    edited.clear();
+    bool woken(false);
+    for (int fd : ready) {
+      if (fd == listener) {
+        acceptClients(listener, poller, clients);
+        continue;
+      }
+      if (fd == wake[0]) {
+        woken = true; // after the reads, which may move what requests view
+        continue;
+      }
+      auto it = clients.find(fd);
+      if (it != clients.end()) {
+        if (it->second.reading) {
+          readFrom(fd, it->second);
+        }
+        takeRequests(fd, it->second, pending);
+      }
+    }
+    if (woken) {
+      takeEdited(wake[0], writer, clients, pending, edited);
+      ready.insert(ready.end(), edited.begin(), edited.end());
+    }
+    answerAll(shared, !aLibrary.readOnly(), writer, pending);
+    for (Pending &p : pending) {
+      if (!isEdit(p.request)) { // edits are replied to once applied
+        clients[p.fd].out += p.reply;
+      }
+    }
+    for (int fd : ready) {
+      auto it = clients.find(fd);
+      if (it == clients.end()) {
+        continue;
+      }
+      Connection &c(it->second);
+      c.in.erase(0, c.inUsed); // the requests' views are no longer needed
+      c.inUsed = 0;
+      writeTo(fd, c);
+      bool unsent(c.outUsed < c.out.size());
+      if (c.closing && !unsent && !c.editing) {
+        poller.forget(fd);
+        ::close(fd);
+        clients.erase(it);
+        continue;
+      }
+      // while an edit is applied, only so much may wait behind it
+      bool reading(!c.closing && c.out.size() - c.outUsed < backlogLimit &&
+                   !(c.editing && c.in.size() >= backlogLimit));
+      if (reading != c.reading || unsent != c.writing) {
+        poller.watch(fd, reading, unsent);
+        c.reading = reading;
+        c.writing = unsent;
+      }
+    }
+  }
+
+  writer.stop(); // the edits it has are applied, if no longer replied to
+  for (const auto &client : clients) {
+    ::close(client.first);
+  }
+  ::close(listener);
+  ::close(wake[0]);
+  ::close(wake[1]);
+  unlink(socketPath.c_str());
+  aLibrary.checkpoint();
+  return true;
+}
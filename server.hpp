@@ -0,0 +1,34 @@
+// server.hpp
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include "library.hpp"
+#include "lms_project.hpp"
+
+/*
+ Daemon mode: one process owns the Library and answers any number of
+ clients (the TUI and command line with --connect, see client.hpp) over a
+ Unix domain socket, so the catalog is loaded once and edits are seen by
+ everyone at once. The wire format is in protocol.hpp.
+
+ A single thread runs the event loop, epoll on Linux and poll elsewhere,
+ over nonblocking sockets. Each pass reads what every ready client has
+ sent and cuts it into requests. Adds and removes go to a writer thread;
+ the lookups are spread over workerPool() (see thread_pool.hpp) meanwhile.
+ The Library is shared through a ConcurrentLibrary (see
+ concurrent_library.hpp), so lookups never wait for an edit, nor for the
+ checkpoint after each batch of them, which folds the journal into a new
+ snapshot, and drops the text of removed books, as the catalog changes
+ rather than only at exit. A client's requests after an edit are not
+ taken until the edit is applied, so every client gets its replies in the
+ order it sent its requests, and every lookup sees the edits its client
+ sent before it. Clients may pipeline; replies are queued and written as
+ each socket drains. Read-only mode answers on the loop thread alone, as
+ its caches fill on first use.
+
+ serve returns on SIGINT or SIGTERM, false if the socket could not be set
+ up. A stale socket file left by a crashed server is replaced.
+ */
+bool serve(Library &aLibrary, const std::string &socketPath);
+
+#endif // SERVER_HPP
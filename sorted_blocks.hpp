@@ -0,0 +1,179 @@
+// sorted_blocks.hpp
+#ifndef SORTED_BLOCKS_HPP
+#define SORTED_BLOCKS_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+/*
+ Sorted sequence kept as a list of short sorted blocks, with the rank of
+ each block's first entry alongside. Finding a value or the entry at a
+ given rank is two binary searches. Inserting or erasing shifts entries
+ within one block and updates one rank per block after it, so it costs
+ O(B + n/B) with B = blockSize rather than the O(n) memmove of a single
+ sorted vector. Iteration walks the blocks in order. No block is ever
+ empty.
+
+ Iterators and references are invalidated by insert, erase and assign.
+ */
+template <class T> class SortedBlocks {
+public:
+  class const_iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T *;
+    using reference = const T &;
+
+    const_iterator() = default;
+    const T &operator*() const { return (*blocks)[block][offset]; }
+    const T *operator->() const { return &(*blocks)[block][offset]; }
+    const_iterator &operator++() {
+      if (++offset == (*blocks)[block].size()) {
+        block++;
+        offset = 0;
+      }
+      return *this;
+    }
+    bool operator==(const const_iterator &other) const {
+      return block == other.block && offset == other.offset;
+    }
+    bool operator!=(const const_iterator &other) const {
+      return !(*this == other);
+    }
+
+  private:
+    friend class SortedBlocks;
+    const_iterator(const std::vector<std::vector<T>> *b, size_t blk,
+                   size_t off)
+        : blocks(b), block(blk), offset(off) {}
+
+    const std::vector<std::vector<T>> *blocks = nullptr;
+    size_t block = 0;
+    size_t offset = 0;
+  };
+
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  const_iterator begin() const { return const_iterator(&blocks, 0, 0); }
+  const_iterator end() const {
+    return const_iterator(&blocks, blocks.size(), 0);
+  }
+
+  // first entry not less than value
+  const_iterator lowerBound(const T &value) const {
+    auto b = std::partition_point(
+        blocks.begin(), blocks.end(),
+        [&value](const std::vector<T> &blk) { return blk.back() < value; });
+    if (b == blocks.end()) {
+      return end();
+    }
+    return const_iterator(&blocks, b - blocks.begin(),
+                          std::lower_bound(b->begin(), b->end(), value) -
+                              b->begin());
+  }
+
+  // first entry greater than value
+  const_iterator upperBound(const T &value) const {
+    auto b = std::partition_point(
+        blocks.begin(), blocks.end(),
+        [&value](const std::vector<T> &blk) { return !(value < blk.back()); });
+    if (b == blocks.end()) {
+      return end();
+    }
+    return const_iterator(&blocks, b - blocks.begin(),
+                          std::upper_bound(b->begin(), b->end(), value) -
+                              b->begin());
+  }
+
+  // the entry of the given rank (0 is the smallest); end() past the last
+  const_iterator at(size_t rank) const {
+    if (rank >= count) {
+      return end();
+    }
+    size_t b(std::upper_bound(starts.begin(), starts.end(), rank) -
+             starts.begin() - 1);
+    return const_iterator(&blocks, b, rank - starts[b]);
+  }
+
+  size_t rank(const const_iterator &it) const {
+    return it.block < blocks.size() ? starts[it.block] + it.offset : count;
+  }
+
+  void insert(const T &value) {
+    if (blocks.empty()) {
+      blocks.emplace_back(1, value);
+      starts.assign(1, 0);
+      count = 1;
+      return;
+    }
+    auto b = std::partition_point(
+        blocks.begin(), blocks.end(),
+        [&value](const std::vector<T> &blk) { return blk.back() < value; });
+    if (b == blocks.end()) {
+      --b; // past every entry: the last block grows
+    }
+    b->insert(std::upper_bound(b->begin(), b->end(), value), value);
+    size_t i(b - blocks.begin());
+    if (b->size() >= 2 * blockSize) {
+      std::vector<T> upper(b->begin() + blockSize, b->end());
+      b->resize(blockSize);
+      blocks.insert(blocks.begin() + i + 1, std::move(upper));
+    }
+    count++;
+    restart(i);
+  }
+
+  // removes one entry equal to value; false if there is none
+  bool erase(const T &value) {
+    const_iterator it(lowerBound(value));
+    if (it == end() || value < *it) {
+      return false;
+    }
+    std::vector<T> &blk(blocks[it.block]);
+    blk.erase(blk.begin() + it.offset);
+    if (blk.empty()) {
+      blocks.erase(blocks.begin() + it.block);
+    }
+    count--;
+    restart(it.block);
+    return true;
+  }
+
+  void clear() {
+    blocks.clear();
+    starts.clear();
+    count = 0;
+  }
+
+  // replaces the contents with sorted, which must already be in order
+  void assign(const std::vector<T> &sorted) {
+    clear();
+    for (size_t i = 0; i < sorted.size(); i += blockSize) {
+      blocks.emplace_back(sorted.begin() + i,
+                          sorted.begin() + std::min(i + blockSize, sorted.size()));
+    }
+    count = sorted.size();
+    restart(0);
+  }
+
+private:
+  static const size_t blockSize = 512;
+
+  // recomputes the start ranks of block first and those after it
+  void restart(size_t first) {
+    starts.resize(blocks.size());
+    for (size_t i = first; i < blocks.size(); i++) {
+      starts[i] = i == 0 ? 0 : starts[i - 1] + blocks[i - 1].size();
+    }
+  }
+
+  std::vector<std::vector<T>> blocks;
+  std::vector<size_t> starts; // rank of each block's first entry
+  size_t count = 0;
+};
+
+#endif // SORTED_BLOCKS_HPP
@@ -0,0 +1,37 @@
+// string_pool.cpp
+
+#include "string_pool.hpp"
+#include "lms_project.hpp"
+
+std::string_view StringPool::intern(std::string_view s) {
+  if (s.empty()) {
+    return std::string_view();
+  }
+  auto it(strings.find(s));
+  if (it != strings.end()) {
+    return *it;
+  }
+  if (s.size() > left) {
+    // long strings get a chunk to themselves so the current one isn't wasted
+    ul n(s.size() > chunkSize / 4 ? s.size() : chunkSize);
+    chunks.emplace_back(new char[n]);
+    if (n == chunkSize) {
+      cursor = chunks.back().get();
+      left = n;
+    } else {
+      std::memcpy(chunks.back().get(), s.data(), s.size());
+      used += s.size();
+      return *strings.emplace(chunks.back().get(), s.size()).first;
+    }
+  }
+  std::memcpy(cursor, s.data(), s.size());
+  std::string_view stored(cursor, s.size());
+  cursor += s.size();
+  left -= s.size();
+  used += s.size();
+  return *strings.emplace(stored).first;
+}
+
+void StringPool::retain(std::shared_ptr<const void> storage) {
+  retained.emplace_back(std::move(storage));
+}
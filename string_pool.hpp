@@ -0,0 +1,44 @@
+// string_pool.hpp
+#ifndef STRING_POOL_HPP
+#define STRING_POOL_HPP
+
+#include "lms_project.hpp"
+
+/*
+ Append-only interning arena for Book fields. intern() returns a view of a
+ single shared copy of the text; views stay valid for the life of the pool,
+ and nothing is freed before then. Storage owned elsewhere, such as a
+ mapped catalog file, can be handed to retain() so views into it stay valid
+ just as long.
+
+ Each Library owns the pool its catalog lives in, and replaces it with a
+ compacted one to drop the text of removed books (see library.hpp). Books
+ made outside any Library own their text instead (see book.hpp).
+
+ Not thread-safe: writers must serialize their calls to intern().
+ */
+class StringPool {
+public:
+  StringPool() = default;
+  StringPool(const StringPool &) = delete;
+  StringPool &operator=(const StringPool &) = delete;
+  // the chunks move with the pool, so views into it stay valid
+  StringPool(StringPool &&) = default;
+  StringPool &operator=(StringPool &&) = default;
+  std::string_view intern(std::string_view s);
+  void retain(std::shared_ptr<const void> storage);
+  ul uniqueStrings() const { return strings.size(); }
+  ul arenaBytes() const { return used; }
+
+private:
+  static const ul chunkSize = 64 * 1024;
+
+  std::vector<std::unique_ptr<char[]>> chunks;
+  char *cursor = nullptr;
+  ul left = 0;
+  ul used = 0;
+  std::unordered_set<std::string_view> strings;
+  std::vector<std::shared_ptr<const void>> retained;
+};
+
+#endif // STRING_POOL_HPP
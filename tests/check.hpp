@@ -0,0 +1,29 @@
+// check.hpp
+#ifndef CHECK_HPP
+#define CHECK_HPP
+
+#include "lms_project.hpp"
+
+/*
+ The tests are plain programs, one per area, built and run by tests/run.sh
+ each in an empty directory of its own. CHECK reports a condition that does
+ not hold, with its line, and carries on; main ends with
+ return checkResult("name"), which is nonzero if any CHECK failed.
+ */
+inline int checkFailures = 0;
+
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__,         \
+              #condition);                                                     \
+      checkFailures++;                                                         \
+    }                                                                          \
+  } while (0)
+
+inline int checkResult(const char *name) {
+  printf("%-16s %s\n", name, checkFailures ? "FAILED" : "ok");
+  return checkFailures != 0;
+}
+
+#endif // CHECK_HPP
@@ -0,0 +1,45 @@
+#!/bin/sh
+# Builds each tests/test_*.cpp against the library sources and runs it in a
+# scratch directory of its own. Run from the top of the tree:
+#
+#   sh tests/run.sh               every test
+#   sh tests/run.sh isbn journal  tests/test_isbn.cpp, tests/test_journal.cpp
+#
+# CXX and CXXFLAGS are honoured. The library objects are kept in
+# tests/build and rebuilt when a source or header is newer.
+CXX=${CXX:-g++}
+SOURCES="book.cpp library.cpp catalog_file.cpp journal.cpp string_pool.cpp
+isbn.cpp text.cpp word_index.cpp fuzzy.cpp thread_pool.cpp bulk_import.cpp
+bulk_export.cpp protocol.cpp server.cpp concurrent_library.cpp client.cpp
+metrics.cpp trace.cpp"
+TOP=$(pwd)
+BUILD=$TOP/tests/build
+mkdir -p "$BUILD" || exit 1
+
+objects=""
+for s in $SOURCES; do
+  o=$BUILD/${s%.cpp}.o
+  if [ ! -f "$o" ] || [ "$s" -nt "$o" ] ||
+     [ -n "$(find . -maxdepth 1 -name '*.hpp' -newer "$o")" ]; then
+    $CXX -std=c++20 $CXXFLAGS -c "$s" -o "$o" || exit 1
+  fi
+  objects="$objects $o"
+done
+
+if [ $# -eq 0 ]; then
+  set -- $(ls tests/test_*.cpp | sed 's|tests/test_||; s|\.cpp$||')
+fi
+failed=0
+for name in "$@"; do
+  binary=$BUILD/test_$name
+  if ! $CXX -std=c++20 $CXXFLAGS -I. "tests/test_$name.cpp" $objects \
+       -o "$binary" -lboost_serialization -pthread; then
+    echo "test_$name     did not build"
+    failed=1
+    continue
+  fi
+  scratch=$(mktemp -d) || exit 1
+  (cd "$scratch" && "$binary") || failed=1
+  rm -rf "$scratch"
+done
+exit $failed
@@ -0,0 +1,73 @@
+// test_book.cpp
+//
+// A Book outside any Library owns its text: copies and moves keep it, and
+// setting a field leaves the others as they were. A Book in a pool views
+// the pool's text.
+
+#include "book.hpp"
+#include "check.hpp"
+#include "string_pool.hpp"
+#include "lms_project.hpp"
+
+namespace {
+
+void owned() {
+  Book *original(new Book("Émile", "Rousseau", "2-07-036822-X"));
+  Book copy(*original);
+  CHECK(copy.getTitleView().data() != original->getTitleView().data());
+  delete original;
+  CHECK(copy.getTitleView() == "Émile");
+  CHECK(copy.getTitleKey() == foldText("Émile"));
+  CHECK(copy.getAuthorKey() == "rousseau");
+  CHECK(copy.getISBNView() == "2-07-036822-X");
+
+  Book moved(std::move(copy));
+  CHECK(moved.getAuthorView() == "Rousseau");
+  Book assigned;
+  assigned = moved;
+  moved.setAuthor("Someone Else");
+  CHECK(assigned.getAuthorView() == "Rousseau");
+  CHECK(moved.getAuthorView() == "Someone Else");
+  CHECK(moved.getAuthorKey() == "someone else");
+  CHECK(moved.getTitleView() == "Émile");
+  assigned = assigned;
+  CHECK(assigned.getISBNView() == "2-07-036822-X");
+}
+
+// the TUI fills a Book in one field at a time
+void filledIn() {
+  Book aBook;
+  aBook.setTitle("  The  Title ");
+  aBook.setAuthor("An Author");
+  aBook.setISBN("9780306406157");
+  aBook.setTitle("Another Title");
+  CHECK(aBook.getTitleView() == "Another Title");
+  CHECK(aBook.getTitleKey() == "another title");
+  CHECK(aBook.getAuthorView() == "An Author");
+  CHECK(aBook.getISBNView() == "9780306406157");
+  aBook.clear();
+  CHECK(aBook.getTitleView().empty() && aBook.getAuthorKey().empty());
+}
+
+void pooled() {
+  StringPool pool;
+  Book inPool(Book("Title", "Author", "123").pooledIn(pool));
+  CHECK(inPool.getAuthorView().data() == pool.intern("Author").data());
+  Book copy(inPool);
+  CHECK(copy.getAuthorView().data() == inPool.getAuthorView().data());
+  Book second("Other", "Author", "456", pool);
+  CHECK(second.getAuthorView().data() == inPool.getAuthorView().data());
+  // setting a field takes the Book out of the pool
+  copy.setISBN("789");
+  CHECK(copy.getTitleView().data() != inPool.getTitleView().data());
+  CHECK(copy.getTitleView() == "Title" && copy.getISBNView() == "789");
+}
+
+} // namespace
+
+int main() {
+  owned();
+  filledIn();
+  pooled();
+  return checkResult("book");
+}
@@ -0,0 +1,191 @@
+// test_catalog_file.cpp
+//
+// writeCatalog and CatalogReader: what is written reads back, the sorted
+// orders answer lookups, and damaged files are refused rather than read
+// out of bounds.
+
+#include "catalog_file.hpp"
+#include "check.hpp"
+#include "isbn.hpp"
+#include "library.hpp"
+#include "text.hpp"
+#include "lms_project.hpp"
+
+namespace {
+
+// the ISBN-13 978 000 00i with its check digit
+std::string isbnFor(ul i) {
+  char digits[16];
+  snprintf(digits, sizeof(digits), "978%09lu", i);
+  int sum(0);
+  for (int d = 0; d < 12; d++) {
+    sum += (digits[d] - '0') * (d % 2 ? 3 : 1);
+  }
+  digits[12] = char('0' + (10 - sum % 10) % 10);
+  digits[13] = 0;
+  return digits;
+}
+
+std::string readFile(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(in), {});
+}
+
+void writeFile(const std::string &path, const std::string &bytes) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(bytes.data(), bytes.size());
+}
+
+umB sampleBooks() {
+  umB books;
+  for (ul i = 0; i < 300; i++) {
+    std::string isbn(isbnFor(i));
+    books.try_emplace(catalogKey(isbn),
+                      Book("Title " + std::to_string(i),
+                           "Author " + std::to_string(i % 7), isbn));
+  }
+  Book accented("Émile ou de l'éducation", "Rousseau", "2-07-036822-X");
+  books.try_emplace(catalogKey(accented.getISBNView()), accented);
+  Book malformed("No Number", "", "not an isbn");
+  books.try_emplace(catalogKey(malformed.getISBNView()), malformed);
+  return books;
+}
+
+void roundTrip() {
+  umB books(sampleBooks());
+  CHECK(writeCatalog("catalog.lms", books));
+  CatalogReader reader;
+  CHECK(reader.open("catalog.lms"));
+  CHECK(reader.size() == books.size());
+  for (ul r = 0; r < reader.size(); r++) {
+    auto found = books.find(catalogKey(reader.isbn(r)));
+    CHECK(found != books.end());
+    if (found != books.end()) {
+      CHECK(reader.title(r) == found->second.getTitleView());
+      CHECK(reader.author(r) == found->second.getAuthorView());
+      CHECK(reader.isbn(r) == found->second.getISBNView());
+    }
+  }
+  // each order is sorted on its key, every record appearing once
+  for (CatalogOrder o : {orderISBN, orderAuthor, orderTitle}) {
+    std::vector<bool> seen(reader.size());
+    for (ul i = 0; i < reader.size(); i++) {
+      ul r(reader.ordered(o, i));
+      CHECK(r < reader.size() && !seen[r]);
+      seen[r] = true;
+      if (i > 0 && o == orderISBN) {
+        CHECK(catalogKey(reader.isbn(reader.ordered(o, i - 1))) <=
+              catalogKey(reader.isbn(r)));
+      } else if (i > 0) {
+        CHECK(foldText(reader.key(o, reader.ordered(o, i - 1))) <=
+              foldText(reader.key(o, r)));
+      }
+    }
+  }
+}
+
+void lookups() {
+  CatalogReader reader;
+  CHECK(reader.open("catalog.lms"));
+  ul first, last;
+  reader.equalRange(orderAuthor, "AUTHOR  3", first, last); // folded
+  CHECK(last - first == 43);
+  for (ul i = first; i < last; i++) {
+    CHECK(reader.author(reader.ordered(orderAuthor, i)) == "Author 3");
+  }
+  reader.equalRange(orderTitle, "emile ou de l'education", first, last);
+  CHECK(last - first == 1);
+  reader.equalRange(orderISBN, "978-0-00000-042-" + isbnFor(42).substr(12),
+                    first, last);
+  CHECK(last - first == 1 &&
+        reader.isbn(reader.ordered(orderISBN, first)) == isbnFor(42));
+  reader.equalRange(orderISBN, "2070368226", first, last); // bad check digit
+  CHECK(last - first == 0);
+  reader.equalRange(orderISBN, "2-07-036822-X", first, last);
+  CHECK(last - first == 1);
+  reader.equalRange(orderISBN, "not an isbn", first, last);
+  CHECK(last - first == 1);
+  reader.prefixRange(orderTitle, "title 29", first, last);
+  CHECK(last - first == 11); // 29 and 290..299
+  reader.equalRange(orderAuthor, "Nobody", first, last);
+  CHECK(first == last);
+}
+
+// a header field overwritten with value, which has the field's type
+template <class T>
+std::string withHeader(std::string bytes, ul offset, T value) {
+  std::memcpy(&bytes[offset], &value, sizeof(value));
+  return bytes;
+}
+
+void damagedFiles() {
+  std::string good(readFile("catalog.lms"));
+  CHECK(good.size() > sizeof(CatalogHeader));
+  CatalogReader reader;
+  auto opens = [&](const std::string &bytes) {
+    writeFile("damaged.lms", bytes);
+    return reader.open("damaged.lms");
+  };
+  CHECK(opens(good));
+  CHECK(!opens(""));
+  CHECK(!opens(good.substr(0, sizeof(CatalogHeader) / 2)));
+  CHECK(!opens(good.substr(0, good.size() / 2)));
+  std::string badMagic(good);
+  badMagic[0] = 'X';
+  CHECK(!opens(badMagic));
+  CHECK(!opens(withHeader(good, offsetof(CatalogHeader, version),
+                          catalogVersion + 1)));
+  CHECK(!opens(withHeader(good, offsetof(CatalogHeader, version),
+                          uint32_t(0))));
+  CHECK(!opens(withHeader(good, offsetof(CatalogHeader, bookCount),
+                          UINT64_MAX / sizeof(CatalogRecord) + 1)));
+  // offsets that would wrap around when added to a size
+  CHECK(!opens(withHeader(good, offsetof(CatalogHeader, recordsOffset),
+                          UINT64_MAX - 8)));
+  CHECK(!opens(withHeader(good, offsetof(CatalogHeader, heapOffset),
+                          UINT64_MAX - 8)));
+  CHECK(!opens(withHeader(good, offsetof(CatalogHeader, heapSize),
+                          UINT64_MAX)));
+  // orders out of the file, or not aligned
+  CHECK(!opens(withHeader(good, offsetof(CatalogHeader, ordersOffset),
+                          UINT64_MAX - 3)));
+  CHECK(!opens(withHeader(good, offsetof(CatalogHeader, ordersOffset),
+                          sizeof(CatalogHeader) + 1)));
+}
+
+// a Library saves its catalog and reads it back, also read-only
+void throughLibrary() {
+  {
+    Library aLibrary;
+    aLibrary.setJournalSyncEvery(0);
+    for (ul i = 0; i < 50; i++) {
+      CHECK(aLibrary.addBook("Book " + std::to_string(i), "Writer",
+                             isbnFor(i)));
+    }
+    CHECK(aLibrary.removeBook(isbnFor(7)));
+    aLibrary.serialize();
+  }
+  Library reloaded;
+  reloaded.deserialize();
+  CHECK(reloaded.size() == 49);
+  vpBook found;
+  reloaded.searchByISBN(isbnFor(8), found);
+  CHECK(found.size() == 1 && found[0]->getTitle() == "Book 8");
+  reloaded.searchByISBN(isbnFor(7), found);
+  CHECK(found.empty());
+  Library kiosk;
+  CHECK(kiosk.openReadOnly());
+  CHECK(kiosk.size() == 49);
+  kiosk.searchByAuthor("writer", found);
+  CHECK(found.size() == 49);
+}
+
+} // namespace
+
+int main() {
+  roundTrip();
+  lookups();
+  damagedFiles();
+  throughLibrary();
+  return checkResult("catalog_file");
+}
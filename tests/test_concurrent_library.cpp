@@ -0,0 +1,176 @@
+// test_concurrent_library.cpp
+//
+// ConcurrentLibrary: both copies of the catalog take the same edits, a
+// batch is seen whole or not at all, and lookups go on while a writer waits
+// for the readers before it.
+
+#include "check.hpp"
+#include "concurrent_library.hpp"
+#include "library.hpp"
+#include "lms_project.hpp"
+
+namespace {
+
+std::string isbnFor(ul i) {
+  char digits[16];
+  snprintf(digits, sizeof(digits), "978%09lu", i);
+  int sum(0);
+  for (int d = 0; d < 12; d++) {
+    sum += (digits[d] - '0') * (d % 2 ? 3 : 1);
+  }
+  digits[12] = char('0' + (10 - sum % 10) % 10);
+  digits[13] = 0;
+  return digits;
+}
+
+BookEdit adding(const std::string &title, const std::string &author,
+                const std::string &isbn) {
+  BookEdit e;
+  e.title = title;
+  e.author = author;
+  e.isbn = isbn;
+  return e;
+}
+
+BookEdit removing(const std::string &isbn) {
+  BookEdit e;
+  e.remove = true;
+  e.isbn = isbn;
+  return e;
+}
+
+// what the copy readers get holds, found through its indexes
+std::string describe(const ConcurrentLibrary &shared) {
+  std::string out;
+  shared.read([&out](const Library &aLibrary) {
+    vpBook found;
+    out = std::to_string(aLibrary.size());
+    for (std::string_view author : {"writer", "other"}) {
+      aLibrary.searchByAuthor(author, found);
+      out += " " + std::to_string(found.size());
+    }
+    aLibrary.catalogPage(orderTitle, 0, 100, found);
+    for (const Book *b : found) {
+      out += "|" + b->getTitle();
+    }
+    aLibrary.searchByWords("renamed", found);
+    out += " words " + std::to_string(found.size());
+  });
+  return out;
+}
+
+void bothCopies() {
+  Library aLibrary;
+  for (ul i = 0; i < 50; i++) {
+    CHECK(aLibrary.addBook("Book " + std::to_string(i), "Writer",
+                           isbnFor(i)));
+  }
+  ConcurrentLibrary shared(aLibrary);
+  std::vector<BookEdit> edits{
+      adding("Renamed", "Other", isbnFor(3)), removing(isbnFor(4)),
+      removing(isbnFor(4)),                   adding("Bad", "Other", "12345"),
+      adding("New", "Other", isbnFor(100)),   removing(isbnFor(999))};
+  shared.apply(edits);
+  CHECK(edits[0].done && edits[1].done && !edits[2].done && !edits[3].done &&
+        edits[4].done && !edits[5].done);
+  CHECK(aLibrary.size() == 50);
+  std::string primary(describe(shared));
+  CHECK(primary.rfind("50 48 2|", 0) == 0);
+  CHECK(primary.find("words 1") != std::string::npos);
+  shared.checkpoint(); // readers are left on the mirror
+  CHECK(describe(shared) == primary);
+  // and the primary saved what it took
+  Library reloaded;
+  reloaded.deserialize();
+  CHECK(reloaded.size() == 50);
+}
+
+// a reader on one copy holds the writer up, but not the other readers
+void readersDoNotWait() {
+  Library aLibrary;
+  CHECK(aLibrary.addBook("First", "Writer", isbnFor(1)));
+  ConcurrentLibrary shared(aLibrary);
+  std::atomic<bool> reading(false), release(false), written(false);
+  std::thread slowReader([&] {
+    shared.read([&](const Library &) {
+      reading = true;
+      while (!release) {
+        std::this_thread::yield();
+      }
+    });
+  });
+  while (!reading) {
+    std::this_thread::yield();
+  }
+  std::thread writer([&] {
+    std::vector<BookEdit> edits{adding("Second", "Writer", isbnFor(2))};
+    shared.apply(edits);
+    written = true;
+  });
+  for (int i = 0; i < 1000; i++) {
+    ul size(0);
+    shared.read([&size](const Library &l) { size = l.size(); });
+    CHECK(size == 1); // the edit is not published before it is done
+  }
+  CHECK(!written);
+  release = true;
+  slowReader.join();
+  writer.join();
+  ul size(0);
+  shared.read([&size](const Library &l) { size = l.size(); });
+  CHECK(size == 2);
+}
+
+// batches of two books, added and removed together, are never seen apart
+void wholeBatches() {
+  Library aLibrary;
+  CHECK(aLibrary.addBook("Stays", "Writer", isbnFor(0)));
+  ConcurrentLibrary shared(aLibrary);
+  std::atomic<bool> stop(false);
+  std::atomic<ul> torn(0), lookups(0);
+  auto reader = [&] {
+    while (!stop) {
+      shared.read([&](const Library &l) {
+        vpBook left, right, stays;
+        l.searchByAuthor("left", left);
+        l.searchByAuthor("right", right);
+        l.searchByISBN(isbnFor(0), stays);
+        if (left.size() != right.size() || stays.size() != 1 ||
+            l.size() != 1 + left.size() + right.size()) {
+          torn++;
+        }
+      });
+      lookups++;
+    }
+  };
+  std::thread readers[2] = {std::thread(reader), std::thread(reader)};
+  while (lookups == 0) {
+    std::this_thread::yield();
+  }
+  for (ul i = 1; i <= 300; i++) {
+    std::vector<BookEdit> edits;
+    if (i % 3 == 0) {
+      edits = {removing(isbnFor(1000 + i - 1)),
+               removing(isbnFor(2000 + i - 1))};
+    } else {
+      edits = {adding("L", "Left", isbnFor(1000 + i)),
+               adding("R", "Right", isbnFor(2000 + i))};
+    }
+    shared.apply(edits);
+  }
+  stop = true;
+  for (std::thread &t : readers) {
+    t.join();
+  }
+  CHECK(torn == 0);
+  CHECK(aLibrary.size() == 1 + 2 * 100);
+}
+
+} // namespace
+
+int main() {
+  bothCopies();
+  readersDoNotWait();
+  wholeBatches();
+  return checkResult("concurrent_library");
+}
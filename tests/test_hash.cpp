@@ -0,0 +1,59 @@
+// test_hash.cpp
+//
+// std::hash<Book> depends on which field holds which text, not only on the
+// texts, and StringHash hashes every spelling of a string alike.
+
+#include "book.hpp"
+#include "check.hpp"
+#include "hash.hpp"
+#include "lms_project.hpp"
+
+namespace {
+
+size_t hashOf(const Book &aBook) { return std::hash<Book>()(aBook); }
+
+void permutedFields() {
+  CHECK(hashOf(Book("Knuth", "Art", "123")) !=
+        hashOf(Book("Art", "Knuth", "123")));
+  CHECK(hashOf(Book("Knuth", "Art", "123")) !=
+        hashOf(Book("123", "Art", "Knuth")));
+  CHECK(hashOf(Book("Knuth", "Art", "123")) !=
+        hashOf(Book("Knuth", "123", "Art")));
+  CHECK(hashOf(Book("Knuth", "Art", "123")) ==
+        hashOf(Book("Knuth", "Art", "123")));
+  CHECK(hashCombine(1, 2) != hashCombine(2, 1));
+  CHECK(hashCombine(0, 0) != 0);
+}
+
+// a field moving to its neighbour is a different book, and hashes so
+void noSharedBuckets() {
+  std::unordered_set<size_t> seen;
+  ul books(0);
+  for (int i = 0; i < 100; i++) {
+    for (int j = 0; j < 100; j++) {
+      if (i == j) {
+        continue;
+      }
+      seen.insert(
+          hashOf(Book(std::to_string(i), std::to_string(j), "978")));
+      books++;
+    }
+  }
+  CHECK(seen.size() == books);
+}
+
+void transparentLookup() {
+  StringHash hash;
+  std::string word("catalog");
+  CHECK(hash(word) == hash(std::string_view(word)));
+  CHECK(hash(word) == hash("catalog"));
+}
+
+} // namespace
+
+int main() {
+  permutedFields();
+  noSharedBuckets();
+  transparentLookup();
+  return checkResult("hash");
+}
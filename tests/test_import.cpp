@@ -0,0 +1,275 @@
+// test_import.cpp
+//
+// Library::importFile over CSV, JSON Lines and MARC: good records are added,
+// duplicates and malformed ones are counted and reported by line or record
+// number, and imports are refused where the catalog cannot change.
+// Library::importText reads back the text archive exportFile writes.
+
+#include "bulk_import.hpp"
+#include "check.hpp"
+#include "library.hpp"
+#include "lms_project.hpp"
+
+namespace {
+
+void writeFile(const std::string &path, const std::string &bytes) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(bytes.data(), bytes.size());
+}
+
+std::string titleOf(const Library &aLibrary, std::string_view isbn) {
+  vpBook found;
+  aLibrary.searchByISBN(isbn, found);
+  return found.size() == 1 ? found[0]->getTitle() : "(none)";
+}
+
+std::string authorOf(const Library &aLibrary, std::string_view isbn) {
+  vpBook found;
+  aLibrary.searchByISBN(isbn, found);
+  return found.size() == 1 ? std::string(found[0]->getAuthorView())
+                           : "(none)";
+}
+
+void formats() {
+  ImportFormat format;
+  CHECK(importFormatFor("books.csv", format) && format == importCSV);
+  CHECK(importFormatFor("dir.v2/BOOKS.CSV", format) && format == importCSV);
+  CHECK(importFormatFor("books.ndjson", format) && format == importJSONLines);
+  CHECK(importFormatFor("books.jsonl", format) && format == importJSONLines);
+  CHECK(importFormatFor("books.mrc", format) && format == importMARC);
+  CHECK(importFormatFor("books.txt", format) && format == importTextArchive);
+  CHECK(!importFormatFor("books.tsv", format));
+  CHECK(!importFormatFor("books", format));
+}
+
+void csv() {
+  writeFile("books.csv", "\xef\xbb\xbfISBN,Title,Author\r\n"
+                         "9780306406157,\"Plain, with comma\",Someone\r\n"
+                         "0-306-40615-2,Duplicate,Someone\r\n"
+                         "\r\n"
+                         "2-07-036822-X,,Nobody\r\n"
+                         "12345,Short,Someone\r\n"
+                         "9791090636071,\"Say \"\"hi\"\"\",Q\r\n"
+                         "9780000000002,\"open,Someone\r\n"
+                         "9782070368228,Existing again,Someone\r\n");
+  Library aLibrary;
+  aLibrary.deserialize();
+  CHECK(aLibrary.addBook("Existing", "Somebody", "2-07-036822-X"));
+  ImportReport report;
+  CHECK(aLibrary.importFile("books.csv", importCSV, report));
+  CHECK(report.added == 2);
+  CHECK(report.duplicates == 2);
+  CHECK(report.malformed == 3);
+  vString expected{
+      "line 3: ISBN 0-306-40615-2 is already in the catalog",
+      "line 5: no title",
+      "line 6: \"12345\" is not a valid ISBN",
+      "line 8: unbalanced quotes",
+      "line 9: ISBN 9782070368228 is already in the catalog",
+  };
+  CHECK(report.problems == expected);
+  CHECK(aLibrary.size() == 3);
+  CHECK(titleOf(aLibrary, "9780306406157") == "Plain, with comma");
+  CHECK(titleOf(aLibrary, "9791090636071") == "Say \"hi\"");
+  CHECK(titleOf(aLibrary, "9782070368228") == "Existing");
+
+  // the import is on disk without a checkpoint
+  Library reloaded;
+  reloaded.deserialize();
+  CHECK(reloaded.size() == 3);
+  vpBook found;
+  reloaded.searchByTitle("say \"hi\"", found);
+  CHECK(found.size() == 1);
+}
+
+void jsonLines() {
+  writeFile("books.jsonl",
+            "{\"title\": \"Json Book\", \"author\": \"A\", \"isbn\": "
+            "\"9780306406157\", \"year\": 1999}\n"
+            "[1, 2]\n"
+            "{\"author\": \"B\", \"isbn\": \"9791090636071\"}\n"
+            "{\"title\": \"Bad\", \"isbn\": \"97800\"}\n"
+            "\n"
+            "{\"isbn\": \"0000000000\", \"author\": \"C\", "
+            "\"title\": \"Esc \\\"q\\\"\"}\n");
+  Library aLibrary;
+  ImportReport report;
+  CHECK(aLibrary.importFile("books.jsonl", importJSONLines, report));
+  CHECK(report.added == 2);
+  CHECK(report.duplicates == 0);
+  CHECK(report.malformed == 3);
+  vString expected{
+      "line 2: not a JSON object",
+      "line 3: no title",
+      "line 4: \"97800\" is not a valid ISBN",
+  };
+  CHECK(report.problems == expected);
+  CHECK(titleOf(aLibrary, "9780306406157") == "Json Book");
+  CHECK(titleOf(aLibrary, "9780000000002") == "Esc \"q\"");
+}
+
+// one MARC 21 record holding the given fields' $a subfields
+std::string marcRecord(
+    const std::vector<std::pair<std::string, std::string>> &fields) {
+  std::string directory, data;
+  for (const auto &[tag, text] : fields) {
+    std::string field("  \x1f" "a" + text + "\x1e");
+    char entry[16];
+    snprintf(entry, sizeof(entry), "%s%04zu%05zu", tag.c_str(), field.size(),
+             data.size());
+    directory += entry;
+    data += field;
+  }
+  ul base(24 + directory.size() + 1);
+  char leader[32];
+  snprintf(leader, sizeof(leader), "%05zunam a22%05zu   4500",
+           base + data.size() + 1, base);
+  return leader + directory + "\x1e" + data + "\x1d";
+}
+
+void marc() {
+  std::string cut(
+      marcRecord({{"245", "Never Ends"}, {"020", "9780306406157"}}));
+  cut.resize(cut.size() - 10);
+  writeFile("books.mrc",
+            marcRecord({{"245", "The Title /"},
+                        {"100", "Author, A.,"},
+                        {"020", "0306406152 (pbk.)"}}) +
+                marcRecord({{"245", "Corporate Title :"},
+                            {"110", "Some Body"},
+                            {"020", "9791090636071"}}) +
+                "garbage\x1d" + cut);
+  Library aLibrary;
+  ImportReport report;
+  CHECK(aLibrary.importFile("books.mrc", importMARC, report));
+  CHECK(report.added == 2);
+  CHECK(report.malformed == 2);
+  vString expected{
+      "record 3: bad MARC leader",
+      "record 4: MARC record is cut short",
+  };
+  CHECK(report.problems == expected);
+  CHECK(titleOf(aLibrary, "9780306406157") == "The Title");
+  CHECK(authorOf(aLibrary, "9780306406157") == "Author, A.");
+  CHECK(titleOf(aLibrary, "9791090636071") == "Corporate Title");
+  CHECK(authorOf(aLibrary, "9791090636071") == "Some Body");
+}
+
+std::string isbnFor(ul i) {
+  char digits[16];
+  snprintf(digits, sizeof(digits), "978%09lu", i);
+  int sum(0);
+  for (int d = 0; d < 12; d++) {
+    sum += (digits[d] - '0') * (d % 2 ? 3 : 1);
+  }
+  digits[12] = char('0' + (10 - sum % 10) % 10);
+  digits[13] = 0;
+  return digits;
+}
+
+/*
+ a file big enough to be parsed in several chunks still reports the
+ file's own line numbers, and only the first few problems are kept
+ */
+void lineNumbers() {
+  std::string body("title,author,isbn\n");
+  const ul lines(60000), every(2999);
+  ul bad(0);
+  for (ul line = 2; line <= lines; line++) {
+    if (line % every == 0) {
+      body += "Broken " + std::to_string(line) + ",Someone,0\n";
+      bad++;
+    } else {
+      body += "Book " + std::to_string(line) + ",Someone," + isbnFor(line) +
+              "\n";
+    }
+  }
+  CHECK(body.size() > 1 << 20);
+  writeFile("big.csv", body);
+  Library aLibrary;
+  ImportReport report;
+  CHECK(aLibrary.importFile("big.csv", importCSV, report));
+  CHECK(report.malformed == bad);
+  CHECK(report.added == lines - 1 - bad);
+  CHECK(report.problems.size() == 20);
+  for (ul i = 0; i < report.problems.size(); i++) {
+    CHECK(report.problems[i] == "line " + std::to_string((i + 1) * every) +
+                                    ": \"0\" is not a valid ISBN");
+  }
+  CHECK(titleOf(aLibrary, isbnFor(lines)) == "Book " + std::to_string(lines));
+}
+
+// export to the text archive, then replace another catalog with it
+void textArchive() {
+  {
+    Library exported;
+    CHECK(exported.addBook("Émile ou de l'éducation", "Rousseau",
+                           "2-07-036822-X"));
+    for (ul i = 0; i < 100; i++) {
+      CHECK(exported.addBook("Title " + std::to_string(i),
+                             "Author " + std::to_string(i % 3), isbnFor(i)));
+    }
+    CHECK(exported.exportFile("archive.txt", exportArchive));
+  }
+  unlink("library_data.lms");
+  unlink("library_data.journal");
+  Library aLibrary;
+  aLibrary.deserialize();
+  CHECK(aLibrary.addBook("Replaced", "Nobody", isbnFor(500)));
+  ImportReport report;
+  CHECK(!aLibrary.importFile("archive.txt", importTextArchive, report));
+  CHECK(aLibrary.importText("archive.txt"));
+  CHECK(aLibrary.size() == 101);
+  CHECK(titleOf(aLibrary, isbnFor(500)) == "(none)");
+  CHECK(titleOf(aLibrary, "9782070368228") == "Émile ou de l'éducation");
+  CHECK(authorOf(aLibrary, isbnFor(41)) == "Author 2");
+  vpBook found;
+  aLibrary.searchByAuthor("author 1", found);
+  CHECK(found.size() == 33);
+
+  // an archive cut short is refused, and the catalog stays as it was
+  std::ifstream in("archive.txt", std::ios::binary);
+  std::string whole((std::istreambuf_iterator<char>(in)), {});
+  writeFile("cut.txt", whole.substr(0, whole.size() / 2));
+  writeFile("junk.txt", "not an archive\n");
+  CHECK(!aLibrary.importText("cut.txt"));
+  CHECK(!aLibrary.importText("junk.txt"));
+  CHECK(!aLibrary.importText("missing.txt"));
+  CHECK(aLibrary.size() == 101);
+  CHECK(titleOf(aLibrary, isbnFor(7)) == "Title 7");
+
+  // and the import is on disk
+  Library reloaded;
+  reloaded.deserialize();
+  CHECK(reloaded.size() == 101);
+  CHECK(titleOf(reloaded, isbnFor(99)) == "Title 99");
+}
+
+void refused() {
+  Library aLibrary;
+  ImportReport report;
+  report.added = 7;
+  CHECK(!aLibrary.importFile("missing.csv", importCSV, report));
+  CHECK(report.added == 0 && report.problems.empty());
+
+  writeFile("one.csv", "Kiosk,Someone,9780306406157\n");
+  aLibrary.serialize(); // an empty catalog to open read-only
+  Library kiosk;
+  CHECK(kiosk.openReadOnly());
+  CHECK(!kiosk.importFile("one.csv", importCSV, report));
+  CHECK(!kiosk.importText("archive.txt"));
+  CHECK(kiosk.size() == 0);
+}
+
+} // namespace
+
+int main() {
+  formats();
+  csv();
+  jsonLines();
+  marc();
+  lineNumbers();
+  textArchive();
+  refused();
+  return checkResult("import");
+}
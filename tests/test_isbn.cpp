@@ -0,0 +1,95 @@
+// test_isbn.cpp
+//
+// parseISBN accepts every spelling of an ISBN and only valid ones, and the
+// Library keys books on the result.
+
+#include "check.hpp"
+#include "isbn.hpp"
+#include "library.hpp"
+#include "lms_project.hpp"
+
+namespace {
+
+bool parsesTo(std::string_view text, uint64_t expected) {
+  uint64_t key(0);
+  return parseISBN(text, key) && key == expected;
+}
+
+bool rejects(std::string_view text) {
+  uint64_t key(12345);
+  return !parseISBN(text, key);
+}
+
+void spellings() {
+  CHECK(parsesTo("9780306406157", 9780306406157));
+  CHECK(parsesTo("978-0-306-40615-7", 9780306406157));
+  CHECK(parsesTo("978 0 306 40615 7", 9780306406157));
+  CHECK(parsesTo("-978--0306 40615-7 ", 9780306406157));
+  // ISBN-10 becomes the 978 ISBN-13, with a recomputed check digit
+  CHECK(parsesTo("0306406152", 9780306406157));
+  CHECK(parsesTo("0-306-40615-2", 9780306406157));
+  CHECK(parsesTo("2-07-036822-X", 9782070368228));
+  CHECK(parsesTo("207036822x", 9782070368228));
+  CHECK(parsesTo("979-10-90636-07-1", 9791090636071));
+  CHECK(parsesTo("0000000000", 9780000000002));
+}
+
+void malformed() {
+  CHECK(rejects(""));
+  CHECK(rejects("---"));
+  CHECK(rejects("9780306406158"));      // check digit
+  CHECK(rejects("0306406153"));         // check digit
+  CHECK(rejects("978030640615"));       // twelve digits
+  CHECK(rejects("97803064061570"));     // fourteen
+  CHECK(rejects("030640615"));          // nine
+  CHECK(rejects("X306406152"));         // X only as the tenth digit
+  CHECK(rejects("978030640615X"));      // and never in an ISBN-13
+  CHECK(rejects("978-0-306-40615-7a")); // trailing text
+  CHECK(rejects("978.0.306.40615.7"));  // only hyphens and spaces are skipped
+  CHECK(rejects("ISBN 9780306406157"));
+  // the key is left alone when the text is refused
+  uint64_t key(42);
+  parseISBN("nope", key);
+  CHECK(key == 42);
+}
+
+void catalogKeys() {
+  CHECK(catalogKey("0-306-40615-2") == 9780306406157);
+  CHECK(catalogKey("978 0306 406157") == catalogKey("0306406152"));
+  // malformed text hashes into the top half, which no ISBN-13 reaches
+  uint64_t bad(catalogKey("not an isbn"));
+  CHECK(bad >> 63 == 1);
+  CHECK(bad == catalogKey("not an isbn"));
+  CHECK(bad != catalogKey("not an ISBN"));
+  CHECK(catalogKey("9780306406158") >> 63 == 1);
+  CHECK(catalogKey("9999999999999") >> 63 == 1); // fails its check digit
+}
+
+// every spelling finds, replaces and removes the same book
+void libraryKeys() {
+  Library aLibrary;
+  CHECK(aLibrary.addBook("Title", "Author", "0-306-40615-2"));
+  CHECK(!aLibrary.addBook("Title", "Author", "0-306-40615-3"));
+  CHECK(!aLibrary.addBook("Title", "Author", "not an isbn"));
+  CHECK(aLibrary.size() == 1);
+  vpBook found;
+  aLibrary.searchByISBN("9780306406157", found);
+  CHECK(found.size() == 1 && found[0]->getISBNView() == "0-306-40615-2");
+  CHECK(aLibrary.addBook("Second Edition", "Author", "978 0 306 40615 7"));
+  CHECK(aLibrary.size() == 1);
+  aLibrary.searchByISBN("0306406152", found);
+  CHECK(found.size() == 1 && found[0]->getTitle() == "Second Edition");
+  CHECK(aLibrary.removeBook("978-0306406157"));
+  CHECK(aLibrary.empty());
+  CHECK(!aLibrary.removeBook("0306406152"));
+}
+
+} // namespace
+
+int main() {
+  spellings();
+  malformed();
+  catalogKeys();
+  libraryKeys();
+  return checkResult("isbn");
+}
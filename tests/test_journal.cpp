@@ -0,0 +1,243 @@
+// test_journal.cpp
+//
+// Journal records replay in order, and a torn or corrupted tail, as a crash
+// mid-write leaves it, is dropped without losing the records before it.
+
+#include "check.hpp"
+#include "journal.hpp"
+#include "library.hpp"
+#include "lms_project.hpp"
+
+namespace {
+
+struct Replayed {
+  JournalOp op;
+  std::string title, author, isbn;
+};
+
+std::vector<Replayed> replayAll(const std::string &path, ul &valid) {
+  std::vector<Replayed> out;
+  valid = Journal::replay(path, [&out](JournalOp op, Book &aBook) {
+    out.push_back({op, std::string(aBook.getTitleView()),
+                   std::string(aBook.getAuthorView()),
+                   std::string(aBook.getISBNView())});
+  });
+  return out;
+}
+
+ul fileSize(const std::string &path) {
+  struct stat st;
+  return stat(path.c_str(), &st) == 0 ? st.st_size : 0;
+}
+
+std::string readFile(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(in), {});
+}
+
+void writeFile(const std::string &path, const std::string &bytes) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(bytes.data(), bytes.size());
+}
+
+// writes five records and returns where each one ends
+std::vector<ul> writeRecords(const std::string &path) {
+  std::vector<ul> ends;
+  Journal journal;
+  CHECK(journal.open(path));
+  journal.setSyncEvery(0);
+  for (int i = 0; i < 5; i++) {
+    Book aBook("Title " + std::to_string(i), "Author, with \"quotes\"",
+               "978000000000" + std::to_string(i));
+    CHECK(journal.append(i == 3 ? journalRemove : journalAdd, aBook));
+    ends.push_back(journal.bytes());
+  }
+  journal.close();
+  CHECK(fileSize(path) == ends.back());
+  return ends;
+}
+
+void inOrder() {
+  std::vector<ul> ends(writeRecords("whole.journal"));
+  ul valid;
+  std::vector<Replayed> records(replayAll("whole.journal", valid));
+  CHECK(valid == ends.back());
+  CHECK(records.size() == 5);
+  for (ul i = 0; i < records.size(); i++) {
+    CHECK(records[i].op == (i == 3 ? journalRemove : journalAdd));
+    CHECK(records[i].title == "Title " + std::to_string(i));
+    CHECK(records[i].author == "Author, with \"quotes\"");
+  }
+  CHECK(replayAll("missing.journal", valid).empty() && valid == 0);
+}
+
+// the file cut at every byte of its last record
+void tornTail() {
+  std::vector<ul> ends(writeRecords("torn.journal"));
+  std::string whole(readFile("torn.journal"));
+  for (ul cut = ends[3]; cut < ends[4]; cut++) {
+    writeFile("torn.journal", whole.substr(0, cut));
+    ul valid;
+    std::vector<Replayed> records(replayAll("torn.journal", valid));
+    CHECK(records.size() == 4);
+    CHECK(valid == ends[3]);
+  }
+}
+
+void corruptRecords() {
+  std::vector<ul> ends(writeRecords("corrupt.journal"));
+  std::string whole(readFile("corrupt.journal"));
+  ul valid;
+  // a flipped byte in the last record's payload fails its checksum
+  std::string flipped(whole);
+  flipped[ends[4] - 2] ^= 0x20;
+  writeFile("corrupt.journal", flipped);
+  CHECK(replayAll("corrupt.journal", valid).size() == 4 && valid == ends[3]);
+  // one in the middle stops replay there, nothing after it is trusted
+  flipped = whole;
+  flipped[ends[1] + 12] ^= 0x01;
+  writeFile("corrupt.journal", flipped);
+  CHECK(replayAll("corrupt.journal", valid).size() == 2 && valid == ends[1]);
+  // a length running past the end of the file
+  flipped = whole;
+  uint32_t huge(UINT32_MAX);
+  std::memcpy(&flipped[ends[2] + 4], &huge, sizeof(huge));
+  writeFile("corrupt.journal", flipped);
+  CHECK(replayAll("corrupt.journal", valid).size() == 3 && valid == ends[2]);
+  // trailing zeroes, as a filesystem may leave after a crash
+  writeFile("corrupt.journal", whole + std::string(64, '\0'));
+  CHECK(replayAll("corrupt.journal", valid).size() == 5 &&
+        valid == ends.back());
+}
+
+// reopening cuts the torn tail, so the next record follows good ones
+void appendAfterTear() {
+  std::vector<ul> ends(writeRecords("reopen.journal"));
+  writeFile("reopen.journal", readFile("reopen.journal").substr(0, ends[4] - 3));
+  {
+    Journal journal;
+    CHECK(journal.open("reopen.journal"));
+    CHECK(journal.bytes() == ends[3]);
+    CHECK(journal.append(journalAdd, Book("After", "Crash", "9780000000099")));
+  }
+  ul valid;
+  std::vector<Replayed> records(replayAll("reopen.journal", valid));
+  CHECK(records.size() == 5 && records.back().title == "After");
+  CHECK(valid == fileSize("reopen.journal"));
+}
+
+std::string isbnFor(ul i) {
+  char digits[16];
+  snprintf(digits, sizeof(digits), "978%09lu", i);
+  int sum(0);
+  for (int d = 0; d < 12; d++) {
+    sum += (digits[d] - '0') * (d % 2 ? 3 : 1);
+  }
+  digits[12] = char('0' + (10 - sum % 10) % 10);
+  digits[13] = 0;
+  return digits;
+}
+
+/*
+ a Library that never saved a snapshot: its edits come back from the
+ journal alone, less the one whose record was torn.
+ */
+void libraryAfterCrash() {
+  {
+    Library aLibrary;
+    aLibrary.deserialize(); // opens the journal
+    for (ul i = 0; i < 20; i++) {
+      CHECK(aLibrary.addBook("Book " + std::to_string(i), "Writer",
+                             isbnFor(i)));
+    }
+    CHECK(aLibrary.removeBook(isbnFor(5)));
+    CHECK(aLibrary.addBook("Last", "Writer", isbnFor(100)));
+  } // no serialize: the journal is all there is
+  CHECK(fileSize("library_data.lms") == 0);
+  ul size(fileSize("library_data.journal"));
+  CHECK(truncate("library_data.journal", size - 1) == 0);
+
+  Library reloaded;
+  reloaded.deserialize();
+  CHECK(reloaded.size() == 19);
+  vpBook found;
+  reloaded.searchByISBN(isbnFor(5), found);
+  CHECK(found.empty());
+  reloaded.searchByISBN(isbnFor(100), found);
+  CHECK(found.empty());
+  reloaded.searchByTitle("book 19", found);
+  CHECK(found.size() == 1);
+  // the torn record was cut off, so a new edit survives the next reload
+  CHECK(reloaded.addBook("Again", "Writer", isbnFor(101)));
+  Library again;
+  again.deserialize();
+  CHECK(again.size() == 20);
+}
+
+// limits the files this process may write to bytes, or lifts the limit
+void limitFileSize(rlim_t bytes) {
+  struct rlimit limit;
+  getrlimit(RLIMIT_FSIZE, &limit);
+  limit.rlim_cur = bytes;
+  setrlimit(RLIMIT_FSIZE, &limit);
+}
+
+/*
+ a record cut short by a full disk is refused and cut off again, so the
+ records appended after it still replay
+ */
+void shortWrite() {
+  std::vector<ul> ends(writeRecords("short.journal"));
+  signal(SIGXFSZ, SIG_IGN); // over the limit, write stops short instead
+  Journal journal;
+  CHECK(journal.open("short.journal"));
+  limitFileSize(ends.back() + 5);
+  CHECK(!journal.append(journalAdd, Book("Lost", "Full", "9780000000101")));
+  limitFileSize(RLIM_INFINITY);
+  CHECK(fileSize("short.journal") == ends.back());
+  CHECK(journal.bytes() == ends.back());
+  CHECK(journal.append(journalAdd, Book("Kept", "After", "9780000000102")));
+  journal.close();
+  ul valid;
+  std::vector<Replayed> records(replayAll("short.journal", valid));
+  CHECK(records.size() == 6 && records.back().title == "Kept");
+  CHECK(valid == fileSize("short.journal"));
+}
+
+// an edit the journal refused is not applied either
+void libraryRefusesUnjournaled() {
+  unlink("library_data.lms");
+  unlink("library_data.journal");
+  {
+    Library aLibrary;
+    aLibrary.deserialize();
+    CHECK(aLibrary.addBook("Kept", "Writer", isbnFor(1)));
+    ul size(fileSize("library_data.journal"));
+    limitFileSize(size + 5);
+    CHECK(!aLibrary.addBook("Lost", "Writer", isbnFor(2)));
+    CHECK(!aLibrary.removeBook(isbnFor(1)));
+    limitFileSize(RLIM_INFINITY);
+    CHECK(aLibrary.size() == 1);
+    CHECK(fileSize("library_data.journal") == size);
+    CHECK(aLibrary.addBook("Later", "Writer", isbnFor(3)));
+  }
+  Library reloaded;
+  reloaded.deserialize();
+  CHECK(reloaded.size() == 2);
+  vpBook found;
+  reloaded.searchByISBN(isbnFor(3), found);
+  CHECK(found.size() == 1);
+}
+
+} // namespace
+
+int main() {
+  inOrder();
+  tornTail();
+  corruptRecords();
+  appendAfterTear();
+  libraryAfterCrash();
+  shortWrite();
+  libraryRefusesUnjournaled();
+  return checkResult("journal");
+}
@@ -0,0 +1,234 @@
+// test_protocol.cpp
+//
+// The wire format on its own, then lms serve end to end: a server thread
+// on a socket in the scratch directory, asked through LibraryClient and
+// through a Library in remote mode.
+
+#include "check.hpp"
+#include "client.hpp"
+#include "library.hpp"
+#include "protocol.hpp"
+#include "server.hpp"
+#include "lms_project.hpp"
+
+namespace {
+
+const char socketPath[] = "test.sock";
+
+void roundTrip() {
+  std::string bytes;
+  vSV fields{"title", "", std::string_view("nul\0inside", 10)};
+  encodeMessage(reqAdd, fields, bytes);
+  CHECK(bytes.size() == sizeof(uint32_t) + messageLength(fields));
+  encodeMessage(reqSize, {}, bytes); // a second one right behind
+  Message message;
+  ul used;
+  CHECK(decodeMessage(bytes, message, used));
+  CHECK(used == sizeof(uint32_t) + messageLength(fields));
+  CHECK(message.code == reqAdd && message.fields == fields);
+  CHECK(decodeMessage(std::string_view(bytes).substr(used), message, used));
+  CHECK(message.code == reqSize && message.fields.empty());
+  CHECK(used == sizeof(uint32_t) + messageLength({}));
+}
+
+// every proper prefix of a message is incomplete, not garbage
+void partial() {
+  std::string bytes;
+  encodeMessage(reqTitlePrefix, {"prefix", "10"}, bytes);
+  Message message;
+  for (ul n = 0; n < bytes.size(); n++) {
+    ul used(99);
+    CHECK(decodeMessage(std::string_view(bytes).substr(0, n), message, used));
+    CHECK(used == 0);
+  }
+}
+
+std::string withU32(std::string bytes, ul offset, uint32_t value) {
+  std::memcpy(&bytes[offset], &value, sizeof(value));
+  return bytes;
+}
+
+void garbage() {
+  std::string bytes;
+  encodeMessage(reqISBN, {"9780306406157"}, bytes);
+  Message message;
+  ul used;
+  CHECK(!decodeMessage(withU32(bytes, 0, 0), message, used));
+  CHECK(!decodeMessage(withU32(bytes, 0, 4), message, used));
+  CHECK(!decodeMessage(withU32(bytes, 0, maxMessage + 1), message, used));
+  // a field count or size that runs past the declared length
+  CHECK(!decodeMessage(withU32(bytes, 5, 2), message, used));
+  CHECK(!decodeMessage(withU32(bytes, 9, 14), message, used));
+  CHECK(!decodeMessage(withU32(bytes, 9, UINT32_MAX), message, used));
+  // bytes left over after the last field
+  CHECK(!decodeMessage(withU32(bytes, 5, 0), message, used));
+  // a length at the limit is still waited for, not refused
+  CHECK(decodeMessage(withU32(bytes, 0, maxMessage), message, used) &&
+        used == 0);
+}
+
+void numbers() {
+  ul n;
+  CHECK(fieldNumber("0", n) && n == 0);
+  CHECK(fieldNumber("1234567890123456789", n) && n == 1234567890123456789ul);
+  CHECK(!fieldNumber("", n));
+  CHECK(!fieldNumber("-1", n));
+  CHECK(!fieldNumber("12a", n));
+  CHECK(!fieldNumber(" 12", n));
+  CHECK(!fieldNumber("12345678901234567890", n)); // past 19 digits
+}
+
+std::string isbnFor(ul i) {
+  char digits[16];
+  snprintf(digits, sizeof(digits), "978%09lu", i);
+  int sum(0);
+  for (int d = 0; d < 12; d++) {
+    sum += (digits[d] - '0') * (d % 2 ? 3 : 1);
+  }
+  digits[12] = char('0' + (10 - sum % 10) % 10);
+  digits[13] = 0;
+  return digits;
+}
+
+// waits for the server thread to be listening
+bool connectSoon(LibraryClient &client) {
+  for (int tries = 0; tries < 500; tries++) {
+    if (client.connect(socketPath)) {
+      return true;
+    }
+    usleep(10000);
+  }
+  return false;
+}
+
+void requests(LibraryClient &client) {
+  Message reply;
+  CHECK(client.call(reqSize, {}, reply));
+  CHECK(reply.code == statusOK && reply.fields == vSV{"3"});
+  CHECK(client.call(reqAdd, {"Fourth", "Writer", isbnFor(4)}, reply));
+  CHECK(reply.code == statusOK && reply.fields.empty());
+  CHECK(client.call(reqAdd, {"Bad", "Writer", "12345"}, reply));
+  CHECK(reply.code == statusRefused);
+  CHECK(client.call(reqISBN, {isbnFor(4)}, reply));
+  CHECK(reply.code == statusOK &&
+        reply.fields == (vSV{"Fourth", "Writer", isbnFor(4)}));
+  CHECK(client.call(reqAuthor, {"WRITER"}, reply));
+  CHECK(reply.code == statusOK && reply.fields.size() == 4 * 3);
+  CHECK(client.call(reqRemove, {isbnFor(1)}, reply));
+  CHECK(reply.code == statusOK);
+  CHECK(client.call(reqRemove, {isbnFor(1)}, reply));
+  CHECK(reply.code == statusRefused);
+
+  // wrong field counts, numbers that are not, and unknown codes
+  CHECK(client.call(reqTitle, {}, reply));
+  CHECK(reply.code == statusBadRequest);
+  CHECK(client.call(reqTitlePrefix, {"first", "ten"}, reply));
+  CHECK(reply.code == statusBadRequest);
+  CHECK(client.call(reqPage, {"7", "0", "10"}, reply));
+  CHECK(reply.code == statusBadRequest);
+  CHECK(client.call(200, {}, reply));
+  CHECK(reply.code == statusBadRequest);
+  CHECK(client.isOpen()); // a bad request is answered, not hung up on
+}
+
+// pipelined requests are answered in order, each after the edits before it
+void pipelined(LibraryClient &client) {
+  const ul n(200);
+  for (ul i = 0; i < n; i++) {
+    if (i % 10 == 0) {
+      client.send(reqAdd,
+                  {"Piped " + std::to_string(i), "Pipe", isbnFor(1000 + i)});
+    } else {
+      client.send(reqISBN, {isbnFor(1000 + i / 10 * 10)});
+    }
+  }
+  Message reply;
+  for (ul i = 0; i < n; i++) {
+    CHECK(client.receive(reply));
+    CHECK(reply.code == statusOK);
+    if (i % 10 != 0) {
+      CHECK(reply.fields.size() == 3 &&
+            reply.fields[0] == "Piped " + std::to_string(i / 10 * 10));
+    }
+  }
+  CHECK(client.call(reqSize, {}, reply) && reply.fields == vSV{"23"});
+}
+
+// a message that cannot be one makes the server hang up
+void hangsUpOnGarbage() {
+  int fd(socket(AF_UNIX, SOCK_STREAM, 0));
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  std::strcpy(address.sun_path, socketPath);
+  CHECK(connect(fd, reinterpret_cast<sockaddr *>(&address),
+                sizeof(address)) == 0);
+  const char junk[] = "\xff\xff\xff\xff garbage";
+  CHECK(write(fd, junk, sizeof(junk)) == ssize_t(sizeof(junk)));
+  char buff[64];
+  CHECK(read(fd, buff, sizeof(buff)) == 0);
+  ::close(fd);
+}
+
+void remoteLibrary() {
+  Library remote;
+  CHECK(remote.connect(socketPath));
+  CHECK(remote.size() == 23);
+  vpBook found;
+  remote.searchByTitle("fourth", found);
+  CHECK(found.size() == 1 && found[0]->getISBNView() == isbnFor(4));
+  CHECK(remote.addBook("Fifth", "Writer", isbnFor(5)));
+  CHECK(!remote.addBook("Fifth", "Writer", "bad"));
+  CHECK(remote.takeRemoteProblem() == nullptr); // refusals are no problem
+  remote.searchByAuthor("writer", found);
+  CHECK(found.size() == 4);
+}
+
+void serverEndToEnd() {
+  Library served;
+  served.deserialize();
+  for (ul i = 1; i <= 3; i++) {
+    CHECK(served.addBook("Book " + std::to_string(i), "Writer", isbnFor(i)));
+  }
+  bool servedOK(false);
+  std::thread server([&served, &servedOK] {
+    servedOK = serve(served, socketPath);
+  });
+  LibraryClient client;
+  CHECK(connectSoon(client));
+  if (client.isOpen()) {
+    requests(client);
+    pipelined(client);
+    hangsUpOnGarbage();
+    remoteLibrary();
+  }
+  Library remote;
+  CHECK(remote.connect(socketPath));
+
+  pthread_kill(server.native_handle(), SIGTERM);
+  server.join();
+  CHECK(servedOK);
+  struct stat st;
+  CHECK(stat(socketPath, &st) != 0); // removed on the way out
+
+  // the client notices the server is gone, and says so
+  Message reply;
+  CHECK(!client.call(reqSize, {}, reply));
+  CHECK(remote.size() == 0);
+  CHECK(remote.takeRemoteProblem() != nullptr);
+
+  // what the clients changed was made durable
+  Library reloaded;
+  reloaded.deserialize();
+  CHECK(reloaded.size() == 24);
+}
+
+} // namespace
+
+int main() {
+  roundTrip();
+  partial();
+  garbage();
+  numbers();
+  serverEndToEnd();
+  return checkResult("protocol");
+}
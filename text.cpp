@@ -0,0 +1,110 @@
+// text.cpp
+
+#include "text.hpp"
+#include "lms_project.hpp"
+
+namespace {
+
+/*
+ ASCII spellings of U+00C0..U+017F (Latin-1 Supplement letters and Latin
+ Extended-A), as runs of consecutive code points sharing one spelling.
+ nullptr marks the two that are not letters (multiplication, division).
+ */
+struct LatinRun {
+  int count;
+  const char *ascii;
+};
+
+const LatinRun latinRuns[] = {
+    // U+00C0..U+00DF
+    {6, "a"}, {1, "ae"}, {1, "c"}, {4, "e"}, {4, "i"}, {1, "d"}, {1, "n"},
+    {5, "o"}, {1, nullptr}, {1, "o"}, {4, "u"}, {1, "y"}, {1, "th"},
+    {1, "ss"},
+    // U+00E0..U+00FF
+    {6, "a"}, {1, "ae"}, {1, "c"}, {4, "e"}, {4, "i"}, {1, "d"}, {1, "n"},
+    {5, "o"}, {1, nullptr}, {1, "o"}, {4, "u"}, {1, "y"}, {1, "th"},
+    {1, "y"},
+    // U+0100..U+017F
+    {6, "a"}, {8, "c"}, {4, "d"}, {10, "e"}, {8, "g"}, {4, "h"}, {10, "i"},
+    {2, "ij"}, {2, "j"}, {3, "k"}, {10, "l"}, {9, "n"}, {6, "o"}, {2, "oe"},
+    {6, "r"}, {8, "s"}, {6, "t"}, {12, "u"}, {2, "w"}, {3, "y"}, {6, "z"},
+    {1, "s"}};
+
+const unsigned latinFirst = 0xC0, latinLast = 0x17F;
+
+const char *latinASCII(unsigned cp) {
+  static const std::vector<const char *> table = [] {
+    std::vector<const char *> t;
+    for (const LatinRun &run : latinRuns) {
+      t.insert(t.end(), run.count, run.ascii);
+    }
+    return t;
+  }();
+  return cp >= latinFirst && cp <= latinLast ? table[cp - latinFirst]
+                                             : nullptr;
+}
+
+} // namespace
+
+std::string foldText(std::string_view s) {
+  std::string folded;
+  foldTextInto(s, folded);
+  return folded;
+}
+
+void foldTextInto(std::string_view s, std::string &folded) {
+  folded.clear();
+  folded.reserve(s.size());
+  bool space(false);
+  for (ul i = 0; i < s.size(); i++) {
+    unsigned char ch(s[i]);
+    if (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r') {
+      space = !folded.empty();
+      continue;
+    }
+    const char *ascii(nullptr);
+    ul skip(0);
+    if (ch >= 0xC3 && ch <= 0xC5 && i + 1 < s.size() &&
+        (s[i + 1] & 0xC0) == 0x80) {
+      ascii = latinASCII(((ch & 0x1F) << 6) | (s[i + 1] & 0x3F));
+      skip = ascii ? 1 : 0;
+    } else if ((ch == 0xCC || ch == 0xCD) && i + 1 < s.size() &&
+               (s[i + 1] & 0xC0) == 0x80 &&
+               (ch == 0xCC || (unsigned char)s[i + 1] <= 0xAF)) {
+      i++; // a combining mark, U+0300..U+036F: drop the accent
+      continue;
+    }
+    if (space) {
+      folded.push_back(' ');
+      space = false;
+    }
+    if (ascii) {
+      folded.append(ascii);
+      i += skip;
+    } else {
+      folded.push_back(ch >= 'A' && ch <= 'Z' ? ch - 'A' + 'a' : ch);
+    }
+  }
+}
+
+void splitWords(std::string_view s, vString &words) {
+  words.clear();
+  std::string folded(foldText(s)), word;
+  for (ul i = 0; i < folded.size(); i++) {
+    unsigned char u(folded[i]);
+    if (u == 0xE2 && i + 2 < folded.size() &&
+        ((unsigned char)folded[i + 1] & 0xFE) == 0x80) {
+      u = ' '; // General Punctuation, U+2000..U+207F: dashes, quotes, ...
+      i += 2;
+    }
+    if ((u >= 'a' && u <= 'z') || (u >= '0' && u <= '9') || u >= 0x80) {
+      word.push_back(u);
+    } else if (!word.empty()) {
+      words.emplace_back(std::move(word));
+      word.clear();
+    }
+  }
+  if (!word.empty()) {
+    words.emplace_back(std::move(word));
+  }
+}
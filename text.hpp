@@ -0,0 +1,27 @@
+// text.hpp
+#ifndef TEXT_HPP
+#define TEXT_HPP
+
+#include "lms_project.hpp"
+
+/*
+ the form titles and authors are compared in for search and sorting: ASCII
+ letters lower-cased, accented Latin letters (U+00C0..U+017F) spelt as
+ their plain ASCII letters, combining accents dropped, runs of white space
+ collapsed to one space, leading and trailing white space dropped. Other
+ UTF-8 text is kept as it is.
+ */
+std::string foldText(std::string_view s);
+// the same into folded, replacing its contents; reusing one buffer for many
+// folds allocates only when a longer text comes along
+void foldTextInto(std::string_view s, std::string &folded);
+
+/*
+ the words of s for the word index: after folding, runs of ASCII letters
+ and digits, and of non-ASCII bytes so other UTF-8 letters stay inside
+ their word. Everything else, Unicode dashes and quotes included,
+ separates words. Replaces the contents of words.
+ */
+void splitWords(std::string_view s, vString &words);
+
+#endif // TEXT_HPP
@@ -0,0 +1,73 @@
+// thread_pool.cpp
+
+#include "thread_pool.hpp"
+#include "trace.hpp"
+#include "lms_project.hpp"
+
+ThreadPool::ThreadPool(ul threads) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (ul i = 1; i < threads; i++) {
+    workers.emplace_back(&ThreadPool::work, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (std::thread &t : workers) {
+    t.join();
+  }
+}
+
+void ThreadPool::run(ul tasks, const std::function<void(ul)> &task) {
+  std::lock_guard<std::mutex> turn(running);
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    job = &task;
+    taskCount = tasks;
+    next = 0;
+    busy = workers.size();
+    generation++;
+  }
+  wake.notify_all();
+  claim();
+  std::unique_lock<std::mutex> guard(lock);
+  done.wait(guard, [this] { return busy == 0; });
+  job = nullptr;
+}
+
+// runs tasks until none are left unclaimed
+void ThreadPool::claim() {
+  for (ul i = next++; i < taskCount; i = next++) {
+    TraceSpan span("pool task");
+    (*job)(i);
+  }
+}
+
+void ThreadPool::work() {
+  ul seen(0);
+  std::unique_lock<std::mutex> guard(lock);
+  while (true) {
+    wake.wait(guard, [&] { return stopping || generation != seen; });
+    if (stopping) {
+      return;
+    }
+    seen = generation;
+    guard.unlock();
+    claim();
+    guard.lock();
+    if (--busy == 0) {
+      done.notify_one();
+    }
+  }
+}
+
+ThreadPool &workerPool() {
+  static ThreadPool pool;
+  return pool;
+}
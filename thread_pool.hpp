@@ -0,0 +1,45 @@
+// thread_pool.hpp
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include "lms_project.hpp"
+
+/*
+ Fixed set of worker threads for fork-join work. run(n, task) calls
+ task(0) .. task(n - 1), spread over the workers and the calling thread,
+ and returns once every call has finished. Tasks are handed out one at a
+ time from a shared counter, so uneven tasks balance themselves; split
+ work into several times size() tasks for that to help.
+
+ One run() at a time: concurrent callers wait their turn.
+ */
+class ThreadPool {
+public:
+  explicit ThreadPool(ul threads = 0); // 0: one per hardware thread
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+  ~ThreadPool();
+  ul size() const { return workers.size() + 1; } // the caller works too
+  void run(ul tasks, const std::function<void(ul)> &task);
+
+private:
+  void work();
+  void claim();
+
+  std::vector<std::thread> workers;
+  std::mutex running; // held for the whole of a run()
+  std::mutex lock;    // guards what follows
+  std::condition_variable wake;
+  std::condition_variable done;
+  const std::function<void(ul)> *job = nullptr;
+  ul taskCount = 0;
+  std::atomic<ul> next{0};
+  ul busy = 0; // workers still inside the current job
+  ul generation = 0;
+  bool stopping = false;
+};
+
+// the pool scans and other parallel work share
+ThreadPool &workerPool();
+
+#endif // THREAD_POOL_HPP
@@ -0,0 +1,104 @@
+// trace.cpp
+
+#include "trace.hpp"
+#include "bulk_export.hpp"
+#include "lms_project.hpp"
+
+namespace {
+
+struct TraceEvent {
+  const char *name;
+  int64_t begin; // ns since traceStart
+  int64_t end;
+};
+
+struct TraceRing {
+  std::array<TraceEvent, traceRingSize> events;
+  std::atomic<ul> written{0}; // ever; the ring holds the last traceRingSize
+  int tid;
+  bool main;
+};
+
+const char *tracePath(std::getenv("LMS_TRACE"));
+const bool enabled(tracePath && *tracePath);
+const std::chrono::steady_clock::time_point traceStart(
+    std::chrono::steady_clock::now());
+const std::thread::id mainThread(std::this_thread::get_id());
+
+// every thread's ring, kept to the end: a thread may finish before saveTrace
+std::mutex ringsLock;
+std::vector<std::unique_ptr<TraceRing>> rings;
+thread_local TraceRing *ring(nullptr);
+
+TraceRing &threadRing() {
+  if (!ring) {
+    std::lock_guard<std::mutex> lock(ringsLock);
+    rings.push_back(std::make_unique<TraceRing>());
+    ring = rings.back().get();
+    ring->tid = rings.size();
+    ring->main = std::this_thread::get_id() == mainThread;
+  }
+  return *ring;
+}
+
+int64_t sinceStart(std::chrono::steady_clock::time_point t) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(t - traceStart)
+      .count();
+}
+
+} // namespace
+
+bool tracing() { return enabled; }
+
+void traceSpan(const char *name, std::chrono::steady_clock::time_point begin,
+               std::chrono::steady_clock::time_point end) {
+  TraceRing &r(threadRing());
+  ul w(r.written.load(std::memory_order_relaxed));
+  r.events[w % traceRingSize] = {name, sinceStart(begin), sinceStart(end)};
+  r.written.store(w + 1, std::memory_order_release);
+}
+
+/*
+ one complete ("X") event per span, timed in microseconds as the format
+ wants, and a thread_name record per thread so the tracks are labelled.
+ Meant to run at exit, with the other threads idle: a span recorded while
+ its ring is being written out may come out torn.
+ */
+bool saveTrace() {
+  if (!enabled) {
+    return true;
+  }
+  FileWriter out;
+  if (!out.open(tracePath)) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(ringsLock);
+  int pid(getpid());
+  char buff[256];
+  bool first(true);
+  auto record = [&](int length) {
+    out.put(first ? "\n" : ",\n");
+    out.put(std::string_view(buff, std::min<int>(length, sizeof(buff) - 1)));
+    first = false;
+  };
+  out.put("{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+  for (const auto &r : rings) {
+    record(snprintf(buff, sizeof(buff),
+                    "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, "
+                    "\"tid\": %d, \"args\": {\"name\": \"%s %d\"}}",
+                    pid, r->tid, r->main ? "main" : "worker", r->tid));
+    ul written(r->written.load(std::memory_order_acquire));
+    for (ul i = written > traceRingSize ? written - traceRingSize : 0;
+         i < written; i++) {
+      const TraceEvent &e(r->events[i % traceRingSize]);
+      // names are literals and identifiers, nothing in them to escape
+      record(snprintf(buff, sizeof(buff),
+                      "{\"name\": \"%s\", \"ph\": \"X\", \"pid\": %d, "
+                      "\"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+                      e.name, pid, r->tid, e.begin / 1e3,
+                      (e.end - e.begin) / 1e3));
+    }
+  }
+  out.put("\n]}\n");
+  return out.close();
+}
@@ -0,0 +1,53 @@
+// trace.hpp
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include "lms_project.hpp"
+
+/*
+ Opt-in tracing of where the time goes. With $LMS_TRACE set to a file
+ name, lms records a span for every Library call (each MetricTimer is
+ one, see metrics.hpp), every menu handler, the stages of paging through
+ books, each curses refresh, and the catalog and archive reads and writes.
+ On exit the spans are written to that file as Chrome trace-event JSON,
+ which ui.perfetto.dev and chrome://tracing open.
+
+ Each thread records into a ring of its own most recent traceRingSize
+ spans: no lock and no allocation after the thread's first span, and a
+ long session keeps its latest spans rather than growing. With $LMS_TRACE
+ unset a span costs a call and a branch.
+
+ Span names must outlive the program (string literals or __func__); only
+ the pointer is kept. Time a scope with TraceSpan span("stage name");
+ */
+const ul traceRingSize = 1 << 16;
+
+bool tracing();
+// records a span that ran from begin to end on the calling thread
+void traceSpan(const char *name, std::chrono::steady_clock::time_point begin,
+               std::chrono::steady_clock::time_point end);
+
+class TraceSpan {
+public:
+  explicit TraceSpan(const char *name) : name(tracing() ? name : nullptr) {
+    if (this->name) {
+      begin = std::chrono::steady_clock::now();
+    }
+  }
+  TraceSpan(const TraceSpan &) = delete;
+  TraceSpan &operator=(const TraceSpan &) = delete;
+  ~TraceSpan() {
+    if (name) {
+      traceSpan(name, begin, std::chrono::steady_clock::now());
+    }
+  }
+
+private:
+  const char *name; // nullptr when not tracing
+  std::chrono::steady_clock::time_point begin;
+};
+
+// writes the recorded spans to $LMS_TRACE if set; false if that failed
+bool saveTrace();
+
+#endif // TRACE_HPP
@@ -0,0 +1,160 @@
+// word_index.cpp
+
+#include "word_index.hpp"
+#include "lms_project.hpp"
+#include "text.hpp"
+
+namespace {
+
+void putVarint(std::vector<uint8_t> &out, uint64_t v) {
+  while (v >= 0x80) {
+    out.push_back(uint8_t(v) | 0x80);
+    v >>= 7;
+  }
+  out.push_back(uint8_t(v));
+}
+
+// side lists are folded into the packed list once they pass this size
+ul mergeThreshold(ul packed) { return 16 + packed / 8; }
+
+} // namespace
+
+void WordIndex::add(std::string_view text, uint64_t key) {
+  vString found;
+  splitWords(text, found);
+  std::sort(found.begin(), found.end());
+  found.erase(std::unique(found.begin(), found.end()), found.end());
+  for (const std::string &word : found) {
+    auto it = lists.find(word);
+    if (it == lists.end()) {
+      it = lists.try_emplace(word).first;
+    }
+    Postings &p(it->second);
+    auto gone(std::lower_bound(p.removed.begin(), p.removed.end(), key));
+    if (gone != p.removed.end() && *gone == key) {
+      p.removed.erase(gone); // it never left the packed list
+    } else if (p.added.empty() && (p.count == 0 || key > p.last)) {
+      append(p, key);
+    } else {
+      auto at(std::lower_bound(p.added.begin(), p.added.end(), key));
+      if (at == p.added.end() || *at != key) {
+        p.added.insert(at, key);
+      }
+    }
+    if (p.added.size() + p.removed.size() > mergeThreshold(p.count)) {
+      compact(p);
+    }
+  }
+}
+
+void WordIndex::remove(std::string_view text, uint64_t key) {
+  vString found;
+  splitWords(text, found);
+  std::sort(found.begin(), found.end());
+  found.erase(std::unique(found.begin(), found.end()), found.end());
+  for (const std::string &word : found) {
+    auto it = lists.find(word);
+    if (it == lists.end()) {
+      continue;
+    }
+    Postings &p(it->second);
+    auto at(std::lower_bound(p.added.begin(), p.added.end(), key));
+    if (at != p.added.end() && *at == key) {
+      p.added.erase(at);
+    } else {
+      auto gone(std::lower_bound(p.removed.begin(), p.removed.end(), key));
+      if (gone == p.removed.end() || *gone != key) {
+        p.removed.insert(gone, key); // callers only remove what they added
+      }
+    }
+    if (p.added.size() + p.removed.size() > mergeThreshold(p.count)) {
+      compact(p);
+    }
+    if (p.count == 0 && p.added.empty()) {
+      lists.erase(it);
+    }
+  }
+}
+
+void WordIndex::clear() { lists.clear(); }
+
+void WordIndex::postings(std::string_view word, vKey &keys) const {
+  keys.clear();
+  auto it = lists.find(word);
+  if (it != lists.end()) {
+    decode(it->second, keys);
+  }
+}
+
+ul WordIndex::frequency(std::string_view word) const {
+  auto it = lists.find(word);
+  if (it == lists.end()) {
+    return 0;
+  }
+  const Postings &p(it->second);
+  return p.count + p.added.size() - p.removed.size();
+}
+
+ul WordIndex::packedBytes() const {
+  ul total(0);
+  for (const auto &aPair : lists) {
+    total += aPair.second.packed.size();
+  }
+  return total;
+}
+
+// the packed keys less removed, merged with added
+void WordIndex::decode(const Postings &p, vKey &keys) {
+  keys.clear();
+  keys.reserve(p.count + p.added.size());
+  auto add(p.added.begin());
+  auto gone(p.removed.begin());
+  uint64_t key(0);
+  ul i(0);
+  for (ul n = 0; n < p.count; n++) {
+    uint64_t delta(0);
+    int shift(0);
+    uint8_t byte;
+    do {
+      byte = p.packed[i++];
+      delta |= uint64_t(byte & 0x7f) << shift;
+      shift += 7;
+    } while (byte & 0x80);
+    key += delta;
+    for (; add != p.added.end() && *add < key; ++add) {
+      keys.push_back(*add);
+    }
+    while (gone != p.removed.end() && *gone < key) {
+      ++gone;
+    }
+    if (gone != p.removed.end() && *gone == key) {
+      continue;
+    }
+    keys.push_back(key);
+  }
+  keys.insert(keys.end(), add, p.added.end());
+}
+
+void WordIndex::encode(const vKey &keys, Postings &p) {
+  p.packed.clear();
+  p.count = 0;
+  p.last = 0;
+  for (uint64_t key : keys) {
+    append(p, key);
+  }
+  p.packed.shrink_to_fit();
+}
+
+void WordIndex::append(Postings &p, uint64_t key) {
+  putVarint(p.packed, p.count == 0 ? key : key - p.last);
+  p.last = key;
+  p.count++;
+}
+
+void WordIndex::compact(Postings &p) {
+  vKey keys;
+  decode(p, keys);
+  p.added.clear();
+  p.removed.clear();
+  encode(keys, p);
+}
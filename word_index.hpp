@@ -0,0 +1,47 @@
+// word_index.hpp
+#ifndef WORD_INDEX_HPP
+#define WORD_INDEX_HPP
+
+#include "lms_project.hpp"
+#include "text.hpp"
+
+/*
+ Inverted index from the words of a field (see splitWords) to the keys of
+ the books containing them. Each word's keys are kept sorted and packed as
+ varint deltas, typically one to three bytes a book.
+
+ A key larger than any already listed is appended in place, so adding
+ books in ascending key order (as rebuilds do) is O(1) a word. Other edits
+ wait in small sorted side lists that are merged into the packed list once
+ they grow past a fraction of it.
+ */
+class WordIndex {
+public:
+  void add(std::string_view text, uint64_t key);
+  void remove(std::string_view text, uint64_t key);
+  void clear();
+  // the sorted keys of the books containing word (already split/folded)
+  void postings(std::string_view word, vKey &keys) const;
+  ul frequency(std::string_view word) const;
+  ul words() const { return lists.size(); }
+  ul packedBytes() const;
+
+private:
+  struct Postings {
+    std::vector<uint8_t> packed; // varint deltas, ascending
+    uint64_t last = 0;           // largest key in packed
+    ul count = 0;                // keys in packed
+    vKey added;                  // sorted, not yet in packed
+    vKey removed;                // sorted, still in packed
+  };
+
+  static void decode(const Postings &, vKey &);
+  static void encode(const vKey &, Postings &);
+  static void append(Postings &, uint64_t key);
+  static void compact(Postings &);
+
+  std::unordered_map<std::string, Postings, StringHash, std::equal_to<>>
+      lists;
+};
+
+#endif // WORD_INDEX_HPP